@@ -0,0 +1,194 @@
+/*
+** bench - Types shared between the benchmark harness and its reporting.
+*/
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "sqlite3.h"
+#include "bench_hist.h"
+
+#define BENCH_MAX_METRICS 192
+
+/*
+** PRAGMA values actually in effect for a test, read back from the connection
+** just before it is closed. These can differ from what was asked for (e.g.
+** journal_mode=WAL on an in-memory database stays "memory").
+*/
+typedef struct bench_pragmas_t {
+    char journal_mode[16];
+    int synchronous;
+    int page_size;
+    int cache_size;
+    int64_t mmap_size;
+} bench_pragmas_t;
+
+
+/*
+** A named, test specific measurement (e.g. reads/sec for the concurrent
+** tests) reported alongside the standard timing columns.
+*/
+typedef struct bench_metric_t {
+    char name[40];
+    double value;
+} bench_metric_t;
+
+
+/*
+** Timing results of a single test. Rows/sec is based on wall-clock time so
+** time spent waiting on the disk counts against the test. "latency" holds the
+** time of every statement step (and COMMIT) inside the timed loop.
+*/
+typedef struct test_result_t {
+    int ran;
+    int skipped;
+    double wall_sec;
+    double user_sec;
+    double sys_sec;
+    double io_wait_sec;
+    int64_t rows;
+    double rows_per_sec;
+    bench_pragmas_t pragmas;
+    bench_hist_t latency;
+    bench_metric_t metrics[BENCH_MAX_METRICS];
+    int num_metrics;
+} test_result_t;
+
+
+/*
+** Benchmark configuration, filled in from the command line. The PRAGMA values
+** are kept as the text given on the command line and are only applied when
+** not NULL, so SQLite's (or the build's) defaults are used otherwise.
+*/
+typedef struct bench_config_t {
+    int num_rows;
+    const char *db_path;
+    int memory_mode;
+    const char *journal_mode;
+    const char *synchronous;
+    const char *page_size;
+    const char *cache_size;
+    const char *mmap_size;
+    const char *tests;
+    const char *schemas;
+    const char *schema;
+    int latency;
+    int latency_series;
+    int series_interval_ms;
+    uint64_t seed;
+    int batch_rows;
+    int shards;
+    int readers;
+    int writers;
+    int producers;
+    int group_rows;
+    int group_delay_us;
+    int sorter_threads;
+    int perf;
+    int io_stats;
+    const char *vfs;
+    const char *device;
+    int sync_us;
+    int write_mbps;
+    const char *json_path;
+    const char *csv_path;
+} bench_config_t;
+
+
+/*
+** Generated values for the num1 - num4 columns of every row, one array per
+** column. Built from the --seed before any timing starts.
+*/
+typedef struct bench_dataset_t {
+    double *num1;
+    double *num2;
+    double *num3;
+    double *num4;
+    int num_rows;
+    double build_sec;
+} bench_dataset_t;
+
+
+/*
+** A test case that can be selected with --tests. Tests in the same group are
+** printed under one table header. Tests with default_on == 0 only run when
+** they are explicitly asked for. Tests with needs_file != 0 open extra
+** connections to the database and are skipped in --memory mode.
+** needs_schema is a set of NEEDS_* flags, see below.
+*/
+typedef struct test_case_t {
+    const char *id;
+    const char *name;
+    const char *group;
+    void(*fun)();
+    void(*setup_fun)();
+    int default_on;
+    int needs_file;
+    int needs_schema;
+} test_case_t;
+
+/*
+** test_case_t.needs_schema flags: what a test needs from the --schema table
+** layout. Tests are skipped under a schema without it. NEEDS_OWN_TABLE
+** marks a test that creates a layout of its own with create_schema_table()
+** instead of the --schema one, so it only runs in the first --schema pass.
+*/
+#define NEEDS_ROWID     0x01
+#define NEEDS_KEY_INDEX 0x02
+#define NEEDS_OWN_TABLE 0x04
+
+
+/*
+** Btree balance counters and the sorter's radix sort switch and counter
+** patched into the vendored sqlite3.c.
+*/
+#if defined SQLITE_BENCH_COUNTERS
+extern int sqlite3_bench_balance_quick;
+extern int sqlite3_bench_balance_nonroot;
+extern int sqlite3_bench_sorter_radix;
+extern int sqlite3_bench_sorter_radix_lists;
+#endif
+
+/*
+** Record decoding counters, only built with SQLITE_BENCH_DECODE_COUNTERS.
+*/
+#if defined SQLITE_BENCH_DECODE_COUNTERS
+extern sqlite3_int64 sqlite3_bench_header_fields;
+extern sqlite3_int64 sqlite3_bench_serial_get;
+extern sqlite3_int64 sqlite3_bench_record_unpack;
+#endif
+
+/*
+** io_uring_enter() calls and submission queue entries of the io_uring
+** VFSes ("unix-uring" and "unix-uring-fixed") in the vendored sqlite3.c.
+*/
+#if defined SQLITE_BENCH_COUNTERS && defined SQLITE_BENCH_IO_URING
+extern sqlite3_int64 sqlite3_bench_uring_enters;
+extern sqlite3_int64 sqlite3_bench_uring_sqes;
+#endif
+
+
+/*
+** Harness functions shared with the test_*.c files. Defined in main.c.
+*/
+const bench_config_t *bench_config();
+sqlite3 *bench_db();
+sqlite3 *open_connection();
+sqlite3 *open_fresh_database(const char *path);
+void remove_database_files(const char *path);
+void apply_pragma(sqlite3 *db, const char *name, const char *value);
+void create_test_table(sqlite3 *db);
+void create_schema_table(sqlite3 *db, const char *schema_id);
+void die_db_error();
+void die_conn_error(sqlite3 *db);
+int64_t latency_begin();
+void latency_end(int64_t start_ns);
+bench_hist_t *bench_latency();
+void bench_add_metric(const char *name, double value);
+void bench_set_rows(int64_t rows);
+const bench_dataset_t *bench_dataset();
+void build_dataset();
+void setup_test();
+void setup_update_test();
+
+#endif
@@ -0,0 +1,294 @@
+/*
+** bench_hist - Low overhead latency histogram and latency-over-time series.
+**
+** Recording is a couple of shifts and an increment so it can sit around every
+** sqlite3_step() in the benchmark loops without distorting them. Percentiles
+** are only computed when the results are printed.
+*/
+#include "bench_hist.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+/*
+** Function prototypes.
+*/
+static int msb64(uint64_t value);
+static size_t bucket_index(int64_t value);
+static int64_t bucket_upper(size_t index);
+static void series_record(bench_hist_t *hist, int64_t start_ns, int64_t latency_ns);
+static bench_series_point_t *series_point(bench_hist_t *hist, int64_t start_ns);
+
+
+/*
+** Initialize an empty histogram. series_interval_ns of 0 turns off the
+** latency-over-time series.
+*/
+void bench_hist_init(bench_hist_t *hist, int64_t series_interval_ns) {
+    memset(hist, 0, sizeof(*hist));
+    hist->series_interval_ns = series_interval_ns;
+    hist->min_ns = INT64_MAX;
+}
+
+
+/*
+** Throw away every sample but keep the settings and series allocation.
+*/
+void bench_hist_reset(bench_hist_t *hist) {
+    memset(hist->buckets, 0, sizeof(hist->buckets));
+    hist->count = 0;
+    hist->sum_ns = 0;
+    hist->min_ns = INT64_MAX;
+    hist->max_ns = 0;
+    hist->series_origin_ns = 0;
+    hist->series_len = 0;
+}
+
+
+/*
+** Release the series memory.
+*/
+void bench_hist_free(bench_hist_t *hist) {
+    free(hist->series);
+    hist->series = NULL;
+    hist->series_len = 0;
+    hist->series_cap = 0;
+}
+
+
+/*
+** Start the series at origin_ns instead of at the first sample. Histograms
+** that will be merged (one per thread) need a common origin.
+*/
+void bench_hist_set_origin(bench_hist_t *hist, int64_t origin_ns) {
+    hist->series_origin_ns = origin_ns;
+}
+
+
+/*
+** Record one operation that started at start_ns and ended at end_ns (both from
+** bench_now_ns()).
+*/
+void bench_hist_record(bench_hist_t *hist, int64_t start_ns, int64_t end_ns) {
+    int64_t latency_ns = end_ns - start_ns;
+
+    if (latency_ns < 0) {
+        latency_ns = 0;
+    }
+
+    ++hist->buckets[bucket_index(latency_ns)];
+    ++hist->count;
+    hist->sum_ns += latency_ns;
+    if (latency_ns < hist->min_ns) {
+        hist->min_ns = latency_ns;
+    }
+    if (latency_ns > hist->max_ns) {
+        hist->max_ns = latency_ns;
+    }
+
+    if (hist->series_interval_ns > 0) {
+        series_record(hist, start_ns, latency_ns);
+    }
+}
+
+
+/*
+** Add every sample of src into dst. The series are combined interval by
+** interval, so both should share the same interval and origin.
+*/
+void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src) {
+    for (size_t i = 0; i < BENCH_HIST_NUM_BUCKETS; ++i) {
+        dst->buckets[i] += src->buckets[i];
+    }
+    dst->count += src->count;
+    dst->sum_ns += src->sum_ns;
+    if (src->min_ns < dst->min_ns) {
+        dst->min_ns = src->min_ns;
+    }
+    if (src->max_ns > dst->max_ns) {
+        dst->max_ns = src->max_ns;
+    }
+
+    if (dst->series_interval_ns <= 0 || src->series_len == 0) {
+        return;
+    }
+    if (dst->series_origin_ns == 0) {
+        dst->series_origin_ns = src->series_origin_ns;
+    }
+
+    for (size_t i = 0; i < src->series_len; ++i) {
+        const bench_series_point_t *from = &src->series[i];
+        bench_series_point_t *to;
+
+        if (from->count == 0) {
+            continue;
+        }
+        to = series_point(dst, src->series_origin_ns + (int64_t)i * src->series_interval_ns);
+        if (to == NULL) {
+            return;
+        }
+        to->count += from->count;
+        to->sum_ns += from->sum_ns;
+        if (from->max_ns > to->max_ns) {
+            to->max_ns = from->max_ns;
+        }
+    }
+}
+
+
+/*
+** Latency at the given percentile (0 - 100). Returns the upper bound of the
+** bucket the percentile falls in, capped at the exact maximum.
+*/
+int64_t bench_hist_percentile(const bench_hist_t *hist, double percentile) {
+    uint64_t target;
+    uint64_t seen = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    target = (uint64_t)(percentile / 100.0 * hist->count + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+    if (target > hist->count) {
+        target = hist->count;
+    }
+
+    for (size_t i = 0; i < BENCH_HIST_NUM_BUCKETS; ++i) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            int64_t upper = bucket_upper(i);
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+
+/*
+** Exact mean latency in nanoseconds.
+*/
+double bench_hist_mean(const bench_hist_t *hist) {
+    return hist->count == 0 ? 0.0 : (double)hist->sum_ns / hist->count;
+}
+
+
+/*
+** Index of the most significant set bit. value must be non-zero.
+*/
+static int msb64(uint64_t value) {
+#if defined __GNUC__
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+
+/*
+** Map a value to its bucket. The first BENCH_HIST_SUB_COUNT buckets are exact;
+** after that each power of two gets BENCH_HIST_SUB_COUNT buckets.
+*/
+static size_t bucket_index(int64_t value) {
+    uint64_t v = (uint64_t)value;
+    int shift;
+
+    if (v < BENCH_HIST_SUB_COUNT) {
+        return (size_t)v;
+    }
+    if (v >= (1ULL << BENCH_HIST_MAX_BITS)) {
+        return BENCH_HIST_NUM_BUCKETS - 1;
+    }
+
+    shift = msb64(v) - BENCH_HIST_SUB_BITS;
+    return (size_t)(shift + 1) * BENCH_HIST_SUB_COUNT + (size_t)((v >> shift) - BENCH_HIST_SUB_COUNT);
+}
+
+
+/*
+** Largest value that maps to the given bucket.
+*/
+static int64_t bucket_upper(size_t index) {
+    int shift;
+    uint64_t sub;
+
+    if (index < BENCH_HIST_SUB_COUNT) {
+        return (int64_t)index;
+    }
+
+    shift = (int)(index / BENCH_HIST_SUB_COUNT) - 1;
+    sub = index % BENCH_HIST_SUB_COUNT;
+    return (int64_t)(((BENCH_HIST_SUB_COUNT + sub + 1) << shift) - 1);
+}
+
+
+/*
+** Add a sample to the interval it started in.
+*/
+static void series_record(bench_hist_t *hist, int64_t start_ns, int64_t latency_ns) {
+    bench_series_point_t *point;
+
+    point = series_point(hist, start_ns);
+    if (point == NULL) {
+        return;
+    }
+
+    ++point->count;
+    point->sum_ns += latency_ns;
+    if (latency_ns > point->max_ns) {
+        point->max_ns = latency_ns;
+    }
+}
+
+
+/*
+** The series interval containing start_ns, growing the series as needed.
+** Intervals with no samples (e.g. during a long stall) are left zeroed.
+** Returns NULL (and turns the series off) if memory runs out.
+*/
+static bench_series_point_t *series_point(bench_hist_t *hist, int64_t start_ns) {
+    size_t slot;
+
+    if (hist->series_origin_ns == 0) {
+        hist->series_origin_ns = start_ns;
+    }
+
+    if (start_ns <= hist->series_origin_ns) {
+        slot = 0;
+    }
+    else {
+        slot = (size_t)((start_ns - hist->series_origin_ns) / hist->series_interval_ns);
+    }
+
+    if (slot >= hist->series_cap) {
+        size_t new_cap = hist->series_cap == 0 ? 256 : hist->series_cap * 2;
+        bench_series_point_t *grown;
+
+        while (new_cap <= slot) {
+            new_cap *= 2;
+        }
+        grown = realloc(hist->series, new_cap * sizeof(*grown));
+        if (grown == NULL) {
+            /*
+            ** Out of memory: keep the histogram but stop growing the series.
+            */
+            hist->series_interval_ns = 0;
+            return NULL;
+        }
+        hist->series = grown;
+        hist->series_cap = new_cap;
+    }
+
+    if (slot >= hist->series_len) {
+        memset(hist->series + hist->series_len, 0, (slot + 1 - hist->series_len) * sizeof(bench_series_point_t));
+        hist->series_len = slot + 1;
+    }
+
+    return &hist->series[slot];
+}
@@ -0,0 +1,61 @@
+/*
+** bench_hist - Low overhead latency histogram and latency-over-time series.
+*/
+#ifndef BENCH_HIST_H
+#define BENCH_HIST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+** Values are bucketed HDR-style: exact below 2^BENCH_HIST_SUB_BITS, and above
+** that each power of two is split into 2^BENCH_HIST_SUB_BITS linear buckets,
+** so any recorded value is off by at most ~3% (1/32). Values are nanoseconds
+** and anything at or above 2^BENCH_HIST_MAX_BITS (~39 hours) is clamped.
+*/
+#define BENCH_HIST_SUB_BITS 5
+#define BENCH_HIST_SUB_COUNT (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_MAX_BITS 47
+#define BENCH_HIST_NUM_BUCKETS ((BENCH_HIST_MAX_BITS - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB_COUNT)
+
+/*
+** One interval of the latency-over-time series.
+*/
+typedef struct bench_series_point_t {
+    uint64_t count;
+    int64_t sum_ns;
+    int64_t max_ns;
+} bench_series_point_t;
+
+/*
+** A histogram of operation latencies. The series splits the same samples into
+** fixed wall-clock intervals measured from the first recorded sample, which
+** is what shows stalls (page splits, checkpoints, cache spills) in time.
+*/
+typedef struct bench_hist_t {
+    uint64_t buckets[BENCH_HIST_NUM_BUCKETS];
+    uint64_t count;
+    int64_t sum_ns;
+    int64_t min_ns;
+    int64_t max_ns;
+
+    int64_t series_interval_ns;
+    int64_t series_origin_ns;
+    bench_series_point_t *series;
+    size_t series_len;
+    size_t series_cap;
+} bench_hist_t;
+
+/*
+** Function prototypes.
+*/
+void bench_hist_init(bench_hist_t *hist, int64_t series_interval_ns);
+void bench_hist_reset(bench_hist_t *hist);
+void bench_hist_free(bench_hist_t *hist);
+void bench_hist_set_origin(bench_hist_t *hist, int64_t origin_ns);
+void bench_hist_record(bench_hist_t *hist, int64_t start_ns, int64_t end_ns);
+void bench_hist_merge(bench_hist_t *dst, const bench_hist_t *src);
+int64_t bench_hist_percentile(const bench_hist_t *hist, double percentile);
+double bench_hist_mean(const bench_hist_t *hist);
+
+#endif
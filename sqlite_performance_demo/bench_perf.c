@@ -0,0 +1,211 @@
+/*
+** bench_perf - Hardware performance counters for the timed section of a
+** test.
+**
+** Seconds alone don't say why a change to the insert path made it faster
+** or slower. These count the CPU cycles, instructions retired, L1 data cache
+** and last level cache misses, branch mispredictions and context switches of
+** this process and every thread it starts while the counters are open, so
+** the multi-threaded tests are counted in full. Each counter is opened on
+** its own rather than as one group, so a counter the CPU lacks (hardware
+** counters are often missing in VMs) only loses that one.
+**
+** With kernel.perf_event_paranoid at 2 or more an unprivileged process can
+** only count user space, so kernel time (system calls, page faults, I/O) is
+** left out of the counts on such systems.
+*/
+#include "bench_perf.h"
+#include <string.h>
+
+#if defined __linux__
+    #include <errno.h>
+    #include <unistd.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <linux/perf_event.h>
+#endif
+
+
+/*
+** What each counter is reported as.
+*/
+static const char *_names[BENCH_PERF_NUM_COUNTERS] = {
+    "cycles",
+    "instructions",
+    "l1d_misses",
+    "llc_misses",
+    "branch_misses",
+    "context_switches",
+};
+
+
+/*
+** Function prototypes.
+*/
+#if defined __linux__
+static int open_counter(int counter);
+static int64_t read_counter(int fd);
+#endif
+
+
+/*
+** Open every counter this system allows. Returns how many it could, 0 on
+** systems without perf_event_open().
+*/
+int bench_perf_open(bench_perf_t *perf) {
+    perf->num_open = 0;
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+#if defined __linux__
+        perf->fds[i] = open_counter(i);
+#else
+        perf->fds[i] = -1;
+#endif
+        if (perf->fds[i] >= 0) {
+            ++perf->num_open;
+        }
+    }
+    return perf->num_open;
+}
+
+
+/*
+** Zero the open counters and start them counting.
+*/
+void bench_perf_start(bench_perf_t *perf) {
+#if defined __linux__
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_RESET, 0);
+        }
+    }
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)perf;
+#endif
+}
+
+
+/*
+** Stop the counters and read what they counted.
+*/
+void bench_perf_stop(bench_perf_t *perf, bench_perf_counts_t *counts) {
+#if defined __linux__
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        if (perf->fds[i] >= 0) {
+            ioctl(perf->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        counts->value[i] = perf->fds[i] >= 0 ? read_counter(perf->fds[i]) : -1;
+    }
+#else
+    (void)perf;
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        counts->value[i] = -1;
+    }
+#endif
+}
+
+
+/*
+** Close the counters.
+*/
+void bench_perf_close(bench_perf_t *perf) {
+#if defined __linux__
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        if (perf->fds[i] >= 0) {
+            close(perf->fds[i]);
+        }
+    }
+#endif
+    memset(perf->fds, 0xff, sizeof(perf->fds));
+    perf->num_open = 0;
+}
+
+
+/*
+** The metric name of a counter ("cycles", "l1d_misses", ...).
+*/
+const char *bench_perf_name(int counter) {
+    return _names[counter];
+}
+
+
+#if defined __linux__
+/*
+** Open one counter, disabled, for this process and the threads it starts
+** from now on. Kernel and hypervisor time are counted when the system
+** allows it, and left out when it doesn't. Returns the fd, or -1.
+*/
+static int open_counter(int counter) {
+    struct perf_event_attr attr;
+    int fd;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+    case BENCH_PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case BENCH_PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case BENCH_PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    case BENCH_PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case BENCH_PERF_BRANCH_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    default:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+    }
+
+    fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    return fd < 0 ? -1 : fd;
+}
+
+
+/*
+** Read a stopped counter, scaled by enabled / running time when the kernel
+** multiplexed it. -1 if it can't be read or never got to run.
+*/
+static int64_t read_counter(int fd) {
+    uint64_t buf[3];
+
+    if (read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+        return -1;
+    }
+    if (buf[2] == 0) {
+        return buf[1] == 0 ? 0 : -1;
+    }
+    if (buf[2] < buf[1]) {
+        return (int64_t)((double)buf[0] * buf[1] / buf[2]);
+    }
+    return (int64_t)buf[0];
+}
+#endif
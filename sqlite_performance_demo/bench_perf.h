@@ -0,0 +1,49 @@
+/*
+** bench_perf - Hardware performance counters for the timed section of a
+** test, through Linux perf_event_open(). Stubs that count nothing elsewhere.
+*/
+#ifndef BENCH_PERF_H
+#define BENCH_PERF_H
+
+#include <stdint.h>
+
+/*
+** The counters, in the order of bench_perf_counts_t.value[].
+*/
+#define BENCH_PERF_CYCLES 0
+#define BENCH_PERF_INSTRUCTIONS 1
+#define BENCH_PERF_L1D_MISSES 2
+#define BENCH_PERF_LLC_MISSES 3
+#define BENCH_PERF_BRANCH_MISSES 4
+#define BENCH_PERF_CONTEXT_SWITCHES 5
+#define BENCH_PERF_NUM_COUNTERS 6
+
+/*
+** An open set of counters. fds[i] is -1 for a counter the CPU, kernel or
+** perf_event_paranoid setting doesn't allow.
+*/
+typedef struct bench_perf_t {
+    int fds[BENCH_PERF_NUM_COUNTERS];
+    int num_open;
+} bench_perf_t;
+
+/*
+** What the counters counted between bench_perf_start() and bench_perf_stop().
+** value[i] is -1 for a counter that isn't open. Counts are scaled up when
+** the kernel had to share the hardware counters between more events than
+** it has, so they are estimates then.
+*/
+typedef struct bench_perf_counts_t {
+    int64_t value[BENCH_PERF_NUM_COUNTERS];
+} bench_perf_counts_t;
+
+/*
+** Function prototypes.
+*/
+int bench_perf_open(bench_perf_t *perf);
+void bench_perf_start(bench_perf_t *perf);
+void bench_perf_stop(bench_perf_t *perf, bench_perf_counts_t *counts);
+void bench_perf_close(bench_perf_t *perf);
+const char *bench_perf_name(int counter);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+** bench_rand - Fast, seeded, platform independent random numbers.
+**
+** xoshiro256** (Blackman and Vigna), seeded through splitmix64 as its authors
+** recommend. Doubles are built from the top 53 bits with an exact power of
+** two scale, so the generated data is identical bit for bit on every host.
+*/
+#include "bench_rand.h"
+
+
+/*
+** Function prototypes.
+*/
+static uint64_t rotl(uint64_t x, int k);
+static uint64_t splitmix64(uint64_t *state);
+
+
+/*
+** Seed the generator. Any seed, including 0, is fine.
+*/
+void bench_rand_seed(bench_rand_t *rand, uint64_t seed) {
+    for (int i = 0; i < 4; ++i) {
+        rand->s[i] = splitmix64(&seed);
+    }
+}
+
+
+/*
+** Next 64 random bits.
+*/
+uint64_t bench_rand_next(bench_rand_t *rand) {
+    uint64_t *s = rand->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+
+/*
+** Uniform double in [0, limit).
+*/
+double bench_rand_double(bench_rand_t *rand, double limit) {
+    return (double)(bench_rand_next(rand) >> 11) * (1.0 / 9007199254740992.0) * limit;
+}
+
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
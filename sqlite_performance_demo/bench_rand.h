@@ -0,0 +1,24 @@
+/*
+** bench_rand - Fast, seeded, platform independent random numbers.
+*/
+#ifndef BENCH_RAND_H
+#define BENCH_RAND_H
+
+#include <stdint.h>
+
+/*
+** xoshiro256** state. Seed with bench_rand_seed(); the same seed gives the
+** same stream on every platform and compiler, unlike rand().
+*/
+typedef struct bench_rand_t {
+    uint64_t s[4];
+} bench_rand_t;
+
+/*
+** Function prototypes.
+*/
+void bench_rand_seed(bench_rand_t *rand, uint64_t seed);
+uint64_t bench_rand_next(bench_rand_t *rand);
+double bench_rand_double(bench_rand_t *rand, double limit);
+
+#endif
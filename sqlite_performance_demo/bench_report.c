@@ -0,0 +1,600 @@
+/*
+** bench_report - Machine readable (JSON lines / CSV) benchmark results.
+**
+** Every record carries the full run metadata (SQLite version and compile
+** options, host, CPU, filesystem, PRAGMAs, row count) so records from
+** different builds and hosts can be concatenated and diffed without any
+** other context. The JSON output is one object per line.
+**
+** A report written to stdout ("-") gets the process's stdout to itself:
+** everything else printed to stdout (the console tables) goes to stderr.
+*/
+#include "bench_report.h"
+#include "sqlite3.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined _WIN32
+    #include <windows.h>
+    #include <io.h>
+    #define dup _dup
+    #define dup2 _dup2
+    #define fileno _fileno
+    #define fdopen _fdopen
+#else
+    #include <unistd.h>
+    #include <sys/utsname.h>
+#endif
+
+#if defined __linux__
+    #include <sys/vfs.h>
+#endif
+
+
+/*
+** Metadata that is the same for every record of a run.
+*/
+typedef struct run_info_t {
+    char timestamp[32];
+    char host[256];
+    char os[256];
+    char cpu[256];
+    int cpu_count;
+    char filesystem[64];
+} run_info_t;
+
+
+/*
+** Function prototypes.
+*/
+static FILE *open_output(const char *path);
+static void close_output(FILE *f);
+static void collect_run_info(const bench_config_t *config);
+static void read_cpu_model(char *buf, size_t size);
+static void read_filesystem(const char *db_path, char *buf, size_t size);
+static void json_string(FILE *f, const char *text);
+static void json_seconds(FILE *f, double sec);
+static void csv_string(FILE *f, const char *text);
+static void write_json(const bench_config_t *config, const test_case_t *test, const test_result_t *result);
+static void write_csv_header();
+static void write_csv(const bench_config_t *config, const test_case_t *test, const test_result_t *result);
+
+
+static run_info_t _run;
+static FILE *_json;
+static FILE *_csv;
+
+/*
+** The original stdout, once a report has taken it over. See open_output().
+*/
+static FILE *_stdout_report;
+
+
+/*
+** Open the --json / --csv outputs ("-" is stdout) and gather run metadata.
+** Does nothing if neither was asked for.
+*/
+void bench_report_open(const bench_config_t *config) {
+    if (config->json_path == NULL && config->csv_path == NULL) {
+        return;
+    }
+
+    collect_run_info(config);
+
+    if (config->json_path != NULL) {
+        _json = open_output(config->json_path);
+    }
+    if (config->csv_path != NULL) {
+        _csv = open_output(config->csv_path);
+        write_csv_header();
+    }
+}
+
+
+/*
+** Write one test result to each open output. Flushed right away so a long
+** run that is killed part way through still leaves usable records.
+*/
+void bench_report_write(const bench_config_t *config, const test_case_t *test, const test_result_t *result) {
+    if (_json != NULL) {
+        write_json(config, test, result);
+        fflush(_json);
+    }
+    if (_csv != NULL) {
+        write_csv(config, test, result);
+        fflush(_csv);
+    }
+}
+
+
+/*
+** Close the outputs.
+*/
+void bench_report_close() {
+    close_output(_json);
+    if (_csv != _json) {
+        /* Both can be the stdout report */
+        close_output(_csv);
+    }
+    _json = NULL;
+    _csv = NULL;
+}
+
+
+/*
+** Open an output file for writing, or stdout for "-". Exits on failure since
+** a sweep that silently loses its results is worse than one that stops.
+**
+** For "-" the report keeps a duplicate of the stdout descriptor and stdout
+** itself is pointed at stderr, so the printf()s of the harness and tests
+** can't interleave with the records.
+*/
+static FILE *open_output(const char *path) {
+    FILE *f;
+    int fd;
+
+    if (strcmp(path, "-") == 0) {
+        if (_stdout_report == NULL) {
+            fflush(stdout);
+            fd = dup(fileno(stdout));
+            if (fd < 0 || (_stdout_report = fdopen(fd, "w")) == NULL) {
+                fprintf(stderr, "Unable to write to stdout.\n");
+                exit(-1);
+            }
+            dup2(fileno(stderr), fileno(stdout));
+        }
+        return _stdout_report;
+    }
+
+    f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Unable to open %s for writing.\n", path);
+        exit(-1);
+    }
+    return f;
+}
+
+
+/*
+** Close an output opened by open_output().
+*/
+static void close_output(FILE *f) {
+    if (f == NULL) {
+        return;
+    }
+    if (f == _stdout_report) {
+        _stdout_report = NULL;
+    }
+    fclose(f);
+}
+
+
+/*
+** Fill in _run.
+*/
+static void collect_run_info(const bench_config_t *config) {
+    time_t now;
+    struct tm *utc;
+
+    now = time(NULL);
+    utc = gmtime(&now);
+    strftime(_run.timestamp, sizeof(_run.timestamp), "%Y-%m-%dT%H:%M:%SZ", utc);
+
+#if defined _WIN32
+    {
+        DWORD size = sizeof(_run.host);
+        SYSTEM_INFO info;
+        OSVERSIONINFOA version;
+
+        if (!GetComputerNameA(_run.host, &size)) {
+            strcpy(_run.host, "unknown");
+        }
+
+        GetSystemInfo(&info);
+        _run.cpu_count = (int)info.dwNumberOfProcessors;
+
+        /*
+        ** GetVersionEx lies without a manifest, but it is good enough to tell
+        ** hosts apart in the results.
+        */
+        memset(&version, 0, sizeof(version));
+        version.dwOSVersionInfoSize = sizeof(version);
+#pragma warning(suppress: 4996)
+        GetVersionExA(&version);
+        snprintf(_run.os, sizeof(_run.os), "Windows %lu.%lu.%lu",
+            version.dwMajorVersion, version.dwMinorVersion, version.dwBuildNumber);
+    }
+#else
+    {
+        struct utsname name;
+
+        if (gethostname(_run.host, sizeof(_run.host)) != 0) {
+            strcpy(_run.host, "unknown");
+        }
+        _run.host[sizeof(_run.host) - 1] = '\0';
+
+        if (uname(&name) == 0) {
+            snprintf(_run.os, sizeof(_run.os), "%s %s %s", name.sysname, name.release, name.machine);
+        }
+        else {
+            strcpy(_run.os, "unknown");
+        }
+
+        _run.cpu_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+#endif
+
+    read_cpu_model(_run.cpu, sizeof(_run.cpu));
+
+    if (config->memory_mode) {
+        strcpy(_run.filesystem, "memory");
+    }
+    else {
+        read_filesystem(config->db_path, _run.filesystem, sizeof(_run.filesystem));
+    }
+}
+
+
+/*
+** CPU model name from /proc/cpuinfo (Linux) or the environment (Windows).
+*/
+static void read_cpu_model(char *buf, size_t size) {
+#if defined __linux__
+    FILE *f;
+    char line[512];
+
+    snprintf(buf, size, "unknown");
+
+    f = fopen("/proc/cpuinfo", "r");
+    if (f == NULL) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (strncmp(line, "model name", 10) == 0) {
+            char *value = strchr(line, ':');
+            if (value != NULL) {
+                value += strspn(value, ": \t");
+                value[strcspn(value, "\r\n")] = '\0';
+                snprintf(buf, size, "%s", value);
+            }
+            break;
+        }
+    }
+    fclose(f);
+#elif defined _WIN32
+    const char *value = getenv("PROCESSOR_IDENTIFIER");
+    snprintf(buf, size, "%s", value != NULL ? value : "unknown");
+#else
+    snprintf(buf, size, "unknown");
+#endif
+}
+
+
+/*
+** Type of the filesystem holding the database file. The file itself is
+** deleted and recreated by each test, so look at its directory instead.
+*/
+static void read_filesystem(const char *db_path, char *buf, size_t size) {
+    char dir[1024];
+    char *slash;
+
+    snprintf(dir, sizeof(dir), "%s", db_path);
+    slash = strrchr(dir, '/');
+#if defined _WIN32
+    {
+        char *back = strrchr(dir, '\\');
+        if (back != NULL && (slash == NULL || back > slash)) {
+            slash = back;
+        }
+    }
+#endif
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    }
+    else if (slash == dir) {
+        dir[1] = '\0';
+    }
+    else {
+        *slash = '\0';
+    }
+
+    snprintf(buf, size, "unknown");
+
+#if defined __linux__
+    {
+        /*
+        ** The filesystem magic numbers from linux/magic.h that are likely to
+        ** hold a database.
+        */
+        static const struct { unsigned long magic; const char *name; } known[] = {
+            { 0xEF53,     "ext4" },
+            { 0x58465342, "xfs" },
+            { 0x9123683E, "btrfs" },
+            { 0x01021994, "tmpfs" },
+            { 0x2FC12FC1, "zfs" },
+            { 0x794C7630, "overlayfs" },
+            { 0x6969,     "nfs" },
+            { 0xFF534D42, "cifs" },
+            { 0x65735546, "fuse" },
+            { 0xF2F52010, "f2fs" },
+            { 0x858458F6, "ramfs" },
+        };
+        struct statfs info;
+
+        if (statfs(dir, &info) == 0) {
+            snprintf(buf, size, "0x%lx", (unsigned long)info.f_type);
+            for (size_t i = 0; i < sizeof(known) / sizeof(known[0]); ++i) {
+                if ((unsigned long)info.f_type == known[i].magic) {
+                    snprintf(buf, size, "%s", known[i].name);
+                    break;
+                }
+            }
+        }
+    }
+#elif defined _WIN32
+    {
+        char volume[MAX_PATH];
+        char fs_name[MAX_PATH];
+
+        if (GetVolumePathNameA(dir, volume, sizeof(volume))
+            && GetVolumeInformationA(volume, NULL, 0, NULL, NULL, NULL, fs_name, sizeof(fs_name))) {
+            snprintf(buf, size, "%s", fs_name);
+        }
+    }
+#endif
+}
+
+
+/*
+** Write a quoted, escaped JSON string.
+*/
+static void json_string(FILE *f, const char *text) {
+    fputc('"', f);
+    for (; *text != '\0'; ++text) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            fputc('\\', f);
+            fputc(c, f);
+        }
+        else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        }
+        else {
+            fputc(c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+
+/*
+** Write a number of seconds, or null for the -1 "not measured" value.
+*/
+static void json_seconds(FILE *f, double sec) {
+    if (sec < 0) {
+        fprintf(f, "null");
+    }
+    else {
+        fprintf(f, "%.9f", sec);
+    }
+}
+
+
+/*
+** Write a quoted CSV field, doubling any embedded quotes.
+*/
+static void csv_string(FILE *f, const char *text) {
+    fputc('"', f);
+    for (; *text != '\0'; ++text) {
+        if (*text == '"') {
+            fputc('"', f);
+        }
+        fputc(*text, f);
+    }
+    fputc('"', f);
+}
+
+
+/*
+** Write one JSON record.
+*/
+static void write_json(const bench_config_t *config, const test_case_t *test, const test_result_t *result) {
+    FILE *f = _json;
+    const bench_hist_t *hist = &result->latency;
+    const char *opt;
+
+    fprintf(f, "{\"timestamp\":");
+    json_string(f, _run.timestamp);
+    fprintf(f, ",\"host\":");
+    json_string(f, _run.host);
+    fprintf(f, ",\"os\":");
+    json_string(f, _run.os);
+    fprintf(f, ",\"cpu\":");
+    json_string(f, _run.cpu);
+    fprintf(f, ",\"cpu_count\":%d", _run.cpu_count);
+    fprintf(f, ",\"filesystem\":");
+    json_string(f, _run.filesystem);
+    fprintf(f, ",\"db_path\":");
+    json_string(f, config->memory_mode ? ":memory:" : config->db_path);
+    fprintf(f, ",\"vfs\":");
+    if (config->vfs != NULL) {
+        json_string(f, config->vfs);
+    }
+    else {
+        fprintf(f, "null");
+    }
+    fprintf(f, ",\"device\":");
+    if (config->device != NULL) {
+        fprintf(f, "{\"id\":");
+        json_string(f, config->device);
+        fprintf(f, ",\"sync_us\":%d,\"write_mbps\":%d}", config->sync_us, config->write_mbps);
+    }
+    else {
+        fprintf(f, "null");
+    }
+
+    fprintf(f, ",\"sqlite_version\":");
+    json_string(f, sqlite3_libversion());
+    fprintf(f, ",\"sqlite_source_id\":");
+    json_string(f, sqlite3_sourceid());
+    fprintf(f, ",\"compile_options\":[");
+    for (int i = 0; (opt = sqlite3_compileoption_get(i)) != NULL; ++i) {
+        if (i > 0) {
+            fputc(',', f);
+        }
+        json_string(f, opt);
+    }
+    fprintf(f, "]");
+
+    fprintf(f, ",\"pragmas\":{\"journal_mode\":");
+    json_string(f, result->pragmas.journal_mode);
+    fprintf(f, ",\"synchronous\":%d,\"page_size\":%d,\"cache_size\":%d,\"mmap_size\":%lld}",
+        result->pragmas.synchronous, result->pragmas.page_size, result->pragmas.cache_size,
+        (long long)result->pragmas.mmap_size);
+
+    fprintf(f, ",\"rows\":%d", config->num_rows);
+    fprintf(f, ",\"rows_processed\":%lld", (long long)result->rows);
+    fprintf(f, ",\"schema\":");
+    json_string(f, config->schema);
+    fprintf(f, ",\"test_id\":");
+    json_string(f, test->id);
+    fprintf(f, ",\"test_name\":");
+    json_string(f, test->name);
+    fprintf(f, ",\"group\":");
+    json_string(f, test->group);
+
+    fprintf(f, ",\"wall_sec\":");
+    json_seconds(f, result->wall_sec);
+    fprintf(f, ",\"user_sec\":");
+    json_seconds(f, result->user_sec);
+    fprintf(f, ",\"sys_sec\":");
+    json_seconds(f, result->sys_sec);
+    fprintf(f, ",\"io_wait_sec\":");
+    json_seconds(f, result->io_wait_sec);
+    fprintf(f, ",\"rows_per_sec\":%.3f", result->rows_per_sec);
+
+    fprintf(f, ",\"latency\":{\"count\":%llu,\"mean_ns\":%.1f,\"min_ns\":%lld,\"p50_ns\":%lld,"
+        "\"p90_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld",
+        (unsigned long long)hist->count,
+        bench_hist_mean(hist),
+        (long long)(hist->count ? hist->min_ns : 0),
+        (long long)bench_hist_percentile(hist, 50.0),
+        (long long)bench_hist_percentile(hist, 90.0),
+        (long long)bench_hist_percentile(hist, 99.0),
+        (long long)bench_hist_percentile(hist, 99.9),
+        (long long)hist->max_ns);
+
+    /*
+    ** Series points are [count, mean_ns, max_ns] per interval.
+    */
+    fprintf(f, ",\"series_interval_ms\":%lld,\"series\":[", (long long)(hist->series_interval_ns / 1000000));
+    for (size_t i = 0; i < hist->series_len; ++i) {
+        const bench_series_point_t *point = &hist->series[i];
+        fprintf(f, "%s[%llu,%.1f,%lld]", i > 0 ? "," : "",
+            (unsigned long long)point->count,
+            point->count ? (double)point->sum_ns / point->count : 0.0,
+            (long long)point->max_ns);
+    }
+    fprintf(f, "]}");
+
+    fprintf(f, ",\"metrics\":{");
+    for (int i = 0; i < result->num_metrics; ++i) {
+        fprintf(f, "%s", i > 0 ? "," : "");
+        json_string(f, result->metrics[i].name);
+        fprintf(f, ":%.17g", result->metrics[i].value);
+    }
+    fprintf(f, "}}\n");
+}
+
+
+/*
+** Write the CSV column names. Must match write_csv().
+*/
+static void write_csv_header() {
+    fprintf(_csv, "timestamp,host,os,cpu,cpu_count,filesystem,db_path,vfs,device,sync_us,write_mbps,"
+        "sqlite_version,compile_options,"
+        "journal_mode,synchronous,page_size,cache_size,mmap_size,rows,rows_processed,schema,test_id,test_name,group,"
+        "wall_sec,user_sec,sys_sec,io_wait_sec,rows_per_sec,"
+        "latency_count,latency_mean_ns,latency_min_ns,latency_p50_ns,latency_p90_ns,latency_p99_ns,"
+        "latency_p999_ns,latency_max_ns,metrics\n");
+}
+
+
+/*
+** Write one CSV row. Compile options are joined with spaces into one field,
+** test specific metrics are "name=value" pairs joined with spaces, and the
+** latency series is left out; use the JSON output for that.
+*/
+static void write_csv(const bench_config_t *config, const test_case_t *test, const test_result_t *result) {
+    FILE *f = _csv;
+    const bench_hist_t *hist = &result->latency;
+    const char *opt;
+
+    csv_string(f, _run.timestamp);
+    fputc(',', f);
+    csv_string(f, _run.host);
+    fputc(',', f);
+    csv_string(f, _run.os);
+    fputc(',', f);
+    csv_string(f, _run.cpu);
+    fprintf(f, ",%d,", _run.cpu_count);
+    csv_string(f, _run.filesystem);
+    fputc(',', f);
+    csv_string(f, config->memory_mode ? ":memory:" : config->db_path);
+    fputc(',', f);
+    if (config->vfs != NULL) {
+        csv_string(f, config->vfs);
+    }
+    fputc(',', f);
+    if (config->device != NULL) {
+        csv_string(f, config->device);
+        fprintf(f, ",%d,%d", config->sync_us, config->write_mbps);
+    }
+    else {
+        fprintf(f, ",,");
+    }
+    fputc(',', f);
+    csv_string(f, sqlite3_libversion());
+
+    fprintf(f, ",\"");
+    for (int i = 0; (opt = sqlite3_compileoption_get(i)) != NULL; ++i) {
+        fprintf(f, "%s%s", i > 0 ? " " : "", opt);
+    }
+    fprintf(f, "\",");
+
+    csv_string(f, result->pragmas.journal_mode);
+    fprintf(f, ",%d,%d,%d,%lld,%d,%lld,",
+        result->pragmas.synchronous, result->pragmas.page_size, result->pragmas.cache_size,
+        (long long)result->pragmas.mmap_size, config->num_rows, (long long)result->rows);
+    csv_string(f, config->schema);
+    fputc(',', f);
+    csv_string(f, test->id);
+    fputc(',', f);
+    csv_string(f, test->name);
+    fputc(',', f);
+    csv_string(f, test->group);
+
+    fprintf(f, ",%.9f,%.9f,%.9f,", result->wall_sec, result->user_sec, result->sys_sec);
+    if (result->io_wait_sec >= 0) {
+        fprintf(f, "%.9f", result->io_wait_sec);
+    }
+    fprintf(f, ",%.3f", result->rows_per_sec);
+
+    fprintf(f, ",%llu,%.1f,%lld,%lld,%lld,%lld,%lld,%lld,\"",
+        (unsigned long long)hist->count,
+        bench_hist_mean(hist),
+        (long long)(hist->count ? hist->min_ns : 0),
+        (long long)bench_hist_percentile(hist, 50.0),
+        (long long)bench_hist_percentile(hist, 90.0),
+        (long long)bench_hist_percentile(hist, 99.0),
+        (long long)bench_hist_percentile(hist, 99.9),
+        (long long)hist->max_ns);
+
+    for (int i = 0; i < result->num_metrics; ++i) {
+        fprintf(f, "%s%s=%.17g", i > 0 ? " " : "", result->metrics[i].name, result->metrics[i].value);
+    }
+    fprintf(f, "\"\n");
+}
@@ -0,0 +1,16 @@
+/*
+** bench_report - Machine readable (JSON lines / CSV) benchmark results.
+*/
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include "bench.h"
+
+/*
+** Function prototypes.
+*/
+void bench_report_open(const bench_config_t *config);
+void bench_report_write(const bench_config_t *config, const test_case_t *test, const test_result_t *result);
+void bench_report_close();
+
+#endif
@@ -0,0 +1,94 @@
+/*
+** bench_thread - Minimal portable threads and atomics for the multi-threaded
+** tests.
+*/
+#include "bench_thread.h"
+
+#if !defined _WIN32
+    #include <sched.h>
+    #include <unistd.h>
+#endif
+
+
+/*
+** Function prototypes.
+*/
+#if defined _WIN32
+static DWORD WINAPI thread_main(LPVOID arg);
+#else
+static void *thread_main(void *arg);
+#endif
+
+
+/*
+** Start a thread running fun(arg). Returns 0 on success.
+*/
+int bench_thread_start(bench_thread_t *thread, void(*fun)(void *arg), void *arg) {
+    thread->fun = fun;
+    thread->arg = arg;
+
+#if defined _WIN32
+    thread->handle = CreateThread(NULL, 0, thread_main, thread, 0, NULL);
+    return thread->handle == NULL ? -1 : 0;
+#else
+    return pthread_create(&thread->handle, NULL, thread_main, thread) == 0 ? 0 : -1;
+#endif
+}
+
+
+/*
+** Wait for a thread started by bench_thread_start() to finish.
+*/
+void bench_thread_join(bench_thread_t *thread) {
+#if defined _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+}
+
+
+/*
+** Give up the rest of this thread's time slice.
+*/
+void bench_thread_yield() {
+#if defined _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+
+/*
+** Number of online CPUs.
+*/
+int bench_cpu_count() {
+#if defined _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+
+/*
+** Adapts the platform thread entry point to void fun(void *).
+*/
+#if defined _WIN32
+static DWORD WINAPI thread_main(LPVOID arg) {
+    bench_thread_t *thread = (bench_thread_t *)arg;
+    thread->fun(thread->arg);
+    return 0;
+}
+#else
+static void *thread_main(void *arg) {
+    bench_thread_t *thread = (bench_thread_t *)arg;
+    thread->fun(thread->arg);
+    return NULL;
+}
+#endif
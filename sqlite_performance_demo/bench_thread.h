@@ -0,0 +1,60 @@
+/*
+** bench_thread - Minimal portable threads and atomics for the multi-threaded
+** tests. Just enough to start/join workers and share a few counters and flags.
+*/
+#ifndef BENCH_THREAD_H
+#define BENCH_THREAD_H
+
+#include <stdint.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+/*
+** A running thread. Start with bench_thread_start(), and always join it.
+*/
+typedef struct bench_thread_t {
+#if defined _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void(*fun)(void *arg);
+    void *arg;
+} bench_thread_t;
+
+/*
+** Function prototypes.
+*/
+int bench_thread_start(bench_thread_t *thread, void(*fun)(void *arg), void *arg);
+void bench_thread_join(bench_thread_t *thread);
+void bench_thread_yield();
+int bench_cpu_count();
+
+/*
+** Sequentially consistent atomics on plain int / int64_t, and on pointers.
+*/
+#if defined _MSC_VER
+    #define bench_atomic_load(p)          InterlockedCompareExchange((volatile LONG *)(p), 0, 0)
+    #define bench_atomic_store(p, v)      InterlockedExchange((volatile LONG *)(p), (v))
+    #define bench_atomic_add(p, v)        (InterlockedExchangeAdd((volatile LONG *)(p), (v)) + (v))
+    #define bench_atomic_load64(p)        InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0)
+    #define bench_atomic_add64(p, v)      (InterlockedExchangeAdd64((volatile LONG64 *)(p), (v)) + (v))
+    #define bench_atomic_load_ptr(p)      InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+    #define bench_atomic_store_ptr(p, v)  InterlockedExchangePointer((PVOID volatile *)(p), (v))
+    #define bench_atomic_xchg_ptr(p, v)   InterlockedExchangePointer((PVOID volatile *)(p), (v))
+#else
+    #define bench_atomic_load(p)          __atomic_load_n((p), __ATOMIC_SEQ_CST)
+    #define bench_atomic_store(p, v)      __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+    #define bench_atomic_add(p, v)        __atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST)
+    #define bench_atomic_load64(p)        __atomic_load_n((p), __ATOMIC_SEQ_CST)
+    #define bench_atomic_add64(p, v)      __atomic_add_fetch((p), (v), __ATOMIC_SEQ_CST)
+    #define bench_atomic_load_ptr(p)      __atomic_load_n((p), __ATOMIC_SEQ_CST)
+    #define bench_atomic_store_ptr(p, v)  __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+    #define bench_atomic_xchg_ptr(p, v)   __atomic_exchange_n((p), (v), __ATOMIC_SEQ_CST)
+#endif
+
+#endif
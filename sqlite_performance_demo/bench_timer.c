@@ -0,0 +1,163 @@
+/*
+** bench_timer - Portable wall-clock and CPU time sampling for the benchmark.
+**
+** clock() only measures CPU time on POSIX systems, so time spent blocked in
+** fsync or waiting on the disk disappears from the results. The wall clock
+** here is monotonic, and CPU time is split into user and system time so an
+** I/O bound test can be told apart from a CPU bound one.
+*/
+#include "bench_timer.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+    #include <unistd.h>
+    #include <sys/resource.h>
+#endif
+
+
+/*
+** Function prototypes.
+*/
+static int64_t read_io_wait_ns();
+
+
+/*
+** Monotonic wall clock in nanoseconds. Only useful for differences.
+*/
+int64_t bench_now_ns() {
+#if defined _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&now);
+
+    return (int64_t)((now.QuadPart / freq.QuadPart) * 1000000000LL
+        + (now.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+
+/*
+** Sample the wall clock, process CPU times and I/O wait.
+*/
+void bench_times_sample(bench_times_t *times) {
+#if defined _WIN32
+    FILETIME create_time, exit_time, kernel_time, user_time;
+    ULARGE_INTEGER t;
+
+    GetProcessTimes(GetCurrentProcess(), &create_time, &exit_time, &kernel_time, &user_time);
+
+    /*
+    ** FILETIME is in 100 nanosecond units.
+    */
+    t.LowPart = user_time.dwLowDateTime;
+    t.HighPart = user_time.dwHighDateTime;
+    times->user_ns = (int64_t)t.QuadPart * 100;
+    t.LowPart = kernel_time.dwLowDateTime;
+    t.HighPart = kernel_time.dwHighDateTime;
+    times->sys_ns = (int64_t)t.QuadPart * 100;
+#else
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    times->user_ns = (int64_t)usage.ru_utime.tv_sec * 1000000000LL + usage.ru_utime.tv_usec * 1000LL;
+    times->sys_ns = (int64_t)usage.ru_stime.tv_sec * 1000000000LL + usage.ru_stime.tv_usec * 1000LL;
+#endif
+
+    times->io_wait_ns = read_io_wait_ns();
+    times->wall_ns = bench_now_ns();
+}
+
+
+/*
+** elapsed = end - start. io_wait_ns stays -1 if either sample lacks it.
+*/
+void bench_times_diff(const bench_times_t *start, const bench_times_t *end, bench_times_t *elapsed) {
+    elapsed->wall_ns = end->wall_ns - start->wall_ns;
+    elapsed->user_ns = end->user_ns - start->user_ns;
+    elapsed->sys_ns = end->sys_ns - start->sys_ns;
+
+    if (start->io_wait_ns < 0 || end->io_wait_ns < 0) {
+        elapsed->io_wait_ns = -1;
+    }
+    else {
+        elapsed->io_wait_ns = end->io_wait_ns - start->io_wait_ns;
+    }
+}
+
+
+/*
+** Read the aggregated block I/O delay for this process. This is field 42
+** (delayacct_blkio_ticks) of /proc/self/stat, in clock ticks. The kernel
+** only fills it in when delay accounting is on (kernel.task_delayacct=1 or
+** the "delayacct" boot option), so it is reported as unknown when it's off.
+*/
+static int64_t read_io_wait_ns() {
+#if defined __linux__
+    FILE *f;
+    char buf[1024];
+    char *p;
+    int field;
+    long long ticks;
+    long hz;
+
+    f = fopen("/proc/sys/kernel/task_delayacct", "r");
+    if (f != NULL) {
+        int enabled = 0;
+        if (fscanf(f, "%d", &enabled) != 1) {
+            enabled = 0;
+        }
+        fclose(f);
+        if (!enabled) {
+            return -1;
+        }
+    }
+
+    f = fopen("/proc/self/stat", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    p = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    if (p == NULL) {
+        return -1;
+    }
+
+    /*
+    ** Field 2 (comm) may contain spaces, so start counting after its ")".
+    */
+    p = strrchr(buf, ')');
+    if (p == NULL) {
+        return -1;
+    }
+    field = 2;
+    while (*p != '\0' && field < 42) {
+        if (*p == ' ') {
+            ++field;
+        }
+        ++p;
+    }
+    if (field != 42 || sscanf(p, "%lld", &ticks) != 1) {
+        return -1;
+    }
+
+    hz = sysconf(_SC_CLK_TCK);
+    if (hz <= 0) {
+        return -1;
+    }
+    return ticks * (1000000000LL / hz);
+#else
+    return -1;
+#endif
+}
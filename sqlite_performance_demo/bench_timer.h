@@ -0,0 +1,31 @@
+/*
+** bench_timer - Portable wall-clock and CPU time sampling for the benchmark.
+*/
+#ifndef BENCH_TIMER_H
+#define BENCH_TIMER_H
+
+#include <stdint.h>
+
+/*
+** A point-in-time sample of the clocks. Take one before and one after the
+** code being timed and pass both to bench_times_diff().
+**
+** io_wait_ns is the block I/O delay the kernel has charged to this process
+** (Linux delay accounting). It is -1 when the platform or kernel doesn't
+** track it.
+*/
+typedef struct bench_times_t {
+    int64_t wall_ns;
+    int64_t user_ns;
+    int64_t sys_ns;
+    int64_t io_wait_ns;
+} bench_times_t;
+
+/*
+** Function prototypes.
+*/
+int64_t bench_now_ns();
+void bench_times_sample(bench_times_t *times);
+void bench_times_diff(const bench_times_t *start, const bench_times_t *end, bench_times_t *elapsed);
+
+#endif
@@ -0,0 +1,569 @@
+/*
+** bench_vfs - A pass-through VFS that counts and times the file I/O SQLite
+** asks for.
+**
+** "bench_io" wraps the default VFS (unix or win32) and is registered as the
+** new default, so every connection the tests open goes through it, from
+** any thread. Each file it opens remembers what SQLite opened it as (the
+** main database, a rollback journal, the WAL, or a temp file such as a
+** sorter run or statement journal), and every xRead, xWrite, xSync,
+** xTruncate, xFileSize, xLock and xUnlock on it is counted and timed under
+** that file type before being handed on. Shared memory, memory mapping and
+** file controls are passed through without being counted.
+**
+** These are the calls SQLite makes, which the real VFS maps onto system
+** calls one to one apart from locking: unixLock() and unixUnlock() only make
+** a fcntl() call when the lock actually has to change on disk.
+**
+** With a device model set (bench_vfs_set_device()) it also stands in for
+** slower storage than the machine has, so commit-heavy tests cost what they
+** would on a disk with multi-millisecond fsync: each xSync of a main
+** database, journal or WAL file is held back for the model's sync latency,
+** and each xWrite to one for its bytes at the model's write bandwidth.
+** The delays are fixed (no queueing between threads, no jitter), so runs
+** are repeatable. They count from the start of the real call, so a call
+** takes as long as the model says or as long as the real I/O took,
+** whichever is more; run on the fastest storage at hand (tmpfs ideally).
+** Temp files are left alone as they are never synced and mostly live in
+** the OS page cache.
+*/
+#include "bench_vfs.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include "sqlite3.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#define BENCH_VFS_NAME "bench_io"
+
+
+/*
+** An open file: the file SQLite sees, followed by the real VFS's file.
+** methods is a copy of _io_methods with the real file's iVersion, so SQLite
+** never calls a method the real file doesn't have.
+*/
+typedef struct bench_file_t {
+    sqlite3_file base;
+    sqlite3_file *real;
+    int file_type;
+    sqlite3_io_methods methods;
+} bench_file_t;
+
+
+/*
+** Function prototypes.
+*/
+static void count_io(int file_type, int op, int64_t bytes, int64_t start_ns);
+static void delay_until(int64_t deadline_ns);
+static int io_close(sqlite3_file *file);
+static int io_read(sqlite3_file *file, void *buf, int amount, sqlite3_int64 offset);
+static int io_write(sqlite3_file *file, const void *buf, int amount, sqlite3_int64 offset);
+static int io_truncate(sqlite3_file *file, sqlite3_int64 size);
+static int io_sync(sqlite3_file *file, int flags);
+static int io_file_size(sqlite3_file *file, sqlite3_int64 *size);
+static int io_lock(sqlite3_file *file, int lock);
+static int io_unlock(sqlite3_file *file, int lock);
+static int io_check_reserved_lock(sqlite3_file *file, int *result);
+static int io_file_control(sqlite3_file *file, int op, void *arg);
+static int io_sector_size(sqlite3_file *file);
+static int io_device_characteristics(sqlite3_file *file);
+static int io_shm_map(sqlite3_file *file, int region, int size, int extend, void volatile **p);
+static int io_shm_lock(sqlite3_file *file, int offset, int n, int flags);
+static void io_shm_barrier(sqlite3_file *file);
+static int io_shm_unmap(sqlite3_file *file, int delete_flag);
+static int io_fetch(sqlite3_file *file, sqlite3_int64 offset, int amount, void **p);
+static int io_unfetch(sqlite3_file *file, sqlite3_int64 offset, void *p);
+static int vfs_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file, int flags, int *out_flags);
+static int vfs_delete(sqlite3_vfs *vfs, const char *name, int sync_dir);
+static int vfs_access(sqlite3_vfs *vfs, const char *name, int flags, int *result);
+static int vfs_full_pathname(sqlite3_vfs *vfs, const char *name, int out_size, char *out);
+static void *vfs_dl_open(sqlite3_vfs *vfs, const char *filename);
+static void vfs_dl_error(sqlite3_vfs *vfs, int size, char *msg);
+static void (*vfs_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void);
+static void vfs_dl_close(sqlite3_vfs *vfs, void *handle);
+static int vfs_randomness(sqlite3_vfs *vfs, int size, char *out);
+static int vfs_sleep(sqlite3_vfs *vfs, int microseconds);
+static int vfs_current_time(sqlite3_vfs *vfs, double *now);
+static int vfs_get_last_error(sqlite3_vfs *vfs, int size, char *msg);
+static int vfs_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *now);
+static int vfs_set_system_call(sqlite3_vfs *vfs, const char *name, sqlite3_syscall_ptr call);
+static sqlite3_syscall_ptr vfs_get_system_call(sqlite3_vfs *vfs, const char *name);
+static const char *vfs_next_system_call(sqlite3_vfs *vfs, const char *name);
+
+
+/*
+** The counters, updated atomically as tests may do I/O from many threads.
+*/
+static bench_io_stats_t _stats;
+
+/*
+** The VFS being wrapped.
+*/
+static sqlite3_vfs *_real_vfs;
+
+/*
+** The simulated device, or NULL for none.
+*/
+static const bench_device_t *_device;
+
+/*
+** The device models. Sync latency and sequential write bandwidth are
+** typical figures for each kind of device, not any one product.
+*/
+static const bench_device_t _device_models[] = {
+    { "nvme",  "NVMe SSD (40 us fsync, 2000 MB/s)",                   40, 2000 },
+    { "cloud", "cloud block volume (1.5 ms fsync, 125 MB/s)",       1500,  125 },
+    { "hdd",   "7200 rpm hard disk (8 ms fsync, 150 MB/s)",         8000,  150 },
+};
+
+#define NUM_DEVICE_MODELS (sizeof(_device_models) / sizeof(_device_models[0]))
+
+static const char *_file_type_names[BENCH_IO_NUM_FILE_TYPES] = { "main", "journal", "wal", "temp" };
+static const char *_op_names[BENCH_IO_NUM_OPS] = { "read", "write", "sync", "truncate", "file_size", "lock" };
+
+static const sqlite3_io_methods _io_methods = {
+    3,
+    io_close,
+    io_read,
+    io_write,
+    io_truncate,
+    io_sync,
+    io_file_size,
+    io_lock,
+    io_unlock,
+    io_check_reserved_lock,
+    io_file_control,
+    io_sector_size,
+    io_device_characteristics,
+    io_shm_map,
+    io_shm_lock,
+    io_shm_barrier,
+    io_shm_unmap,
+    io_fetch,
+    io_unfetch,
+};
+
+static sqlite3_vfs _vfs = {
+    3,
+    0,
+    0,
+    NULL,
+    BENCH_VFS_NAME,
+    NULL,
+    vfs_open,
+    vfs_delete,
+    vfs_access,
+    vfs_full_pathname,
+    vfs_dl_open,
+    vfs_dl_error,
+    vfs_dl_sym,
+    vfs_dl_close,
+    vfs_randomness,
+    vfs_sleep,
+    vfs_current_time,
+    vfs_get_last_error,
+    vfs_current_time_int64,
+    vfs_set_system_call,
+    vfs_get_system_call,
+    vfs_next_system_call,
+};
+
+
+/*
+** Wrap the current default VFS and make bench_io the default. Must be
+** called before any connection is opened. Returns an SQLite result code.
+*/
+int bench_vfs_register() {
+    if (_real_vfs != NULL) {
+        return SQLITE_OK;
+    }
+    _real_vfs = sqlite3_vfs_find(NULL);
+    if (_real_vfs == NULL) {
+        return SQLITE_ERROR;
+    }
+
+    _vfs.iVersion = _real_vfs->iVersion < 3 ? _real_vfs->iVersion : 3;
+    _vfs.szOsFile = (int)sizeof(bench_file_t) + _real_vfs->szOsFile;
+    _vfs.mxPathname = _real_vfs->mxPathname;
+    return sqlite3_vfs_register(&_vfs, 1);
+}
+
+
+/*
+** Simulate device (NULL for none) from now on. The VFS must be registered
+** for it to take effect.
+*/
+void bench_vfs_set_device(const bench_device_t *device) {
+    _device = device;
+}
+
+
+/*
+** The device model with the given id, or NULL.
+*/
+const bench_device_t *bench_device_find(const char *id) {
+    for (size_t i = 0; i < NUM_DEVICE_MODELS; ++i) {
+        if (strcmp(_device_models[i].id, id) == 0) {
+            return &_device_models[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*
+** All of the device models, for the usage message.
+*/
+const bench_device_t *bench_device_models(int *count) {
+    *count = (int)NUM_DEVICE_MODELS;
+    return _device_models;
+}
+
+
+/*
+** Copy the counters so far. All 0 if the VFS isn't registered.
+*/
+void bench_vfs_sample(bench_io_stats_t *stats) {
+    for (int t = 0; t < BENCH_IO_NUM_FILE_TYPES; ++t) {
+        for (int o = 0; o < BENCH_IO_NUM_OPS; ++o) {
+            stats->stat[t][o].calls = bench_atomic_load64(&_stats.stat[t][o].calls);
+            stats->stat[t][o].bytes = bench_atomic_load64(&_stats.stat[t][o].bytes);
+            stats->stat[t][o].ns = bench_atomic_load64(&_stats.stat[t][o].ns);
+        }
+    }
+}
+
+
+/*
+** elapsed = end - start.
+*/
+void bench_vfs_diff(const bench_io_stats_t *start, const bench_io_stats_t *end, bench_io_stats_t *elapsed) {
+    for (int t = 0; t < BENCH_IO_NUM_FILE_TYPES; ++t) {
+        for (int o = 0; o < BENCH_IO_NUM_OPS; ++o) {
+            elapsed->stat[t][o].calls = end->stat[t][o].calls - start->stat[t][o].calls;
+            elapsed->stat[t][o].bytes = end->stat[t][o].bytes - start->stat[t][o].bytes;
+            elapsed->stat[t][o].ns = end->stat[t][o].ns - start->stat[t][o].ns;
+        }
+    }
+}
+
+
+/*
+** The metric name prefix of a file type ("main", "journal", ...).
+*/
+const char *bench_io_file_type_name(int file_type) {
+    return _file_type_names[file_type];
+}
+
+
+/*
+** The metric name of a counted method ("read", "sync", ...).
+*/
+const char *bench_io_op_name(int op) {
+    return _op_names[op];
+}
+
+
+/*
+** Count one call that started at start_ns and moved bytes bytes.
+*/
+static void count_io(int file_type, int op, int64_t bytes, int64_t start_ns) {
+    bench_io_stat_t *stat = &_stats.stat[file_type][op];
+
+    bench_atomic_add64(&stat->ns, bench_now_ns() - start_ns);
+    bench_atomic_add64(&stat->calls, 1);
+    if (bytes != 0) {
+        bench_atomic_add64(&stat->bytes, bytes);
+    }
+}
+
+
+/*
+** Sleep until bench_now_ns() reaches deadline_ns. The whole delay is slept,
+** never spun, so it isn't charged to the test's user CPU time or perf
+** counters; a sleep can overshoot by the scheduler's wakeup latency (tens of
+** microseconds on Linux). Windows' Sleep() takes whole milliseconds and
+** only wakes on a system timer tick (15.6 ms unless something has raised
+** the timer resolution with timeBeginPeriod()), so there the delays are
+** rounded up and --sync-us below a tick comes out as a tick. Not the real
+** VFS's xSleep, which rounds up to whole seconds when SQLite is built
+** without HAVE_USLEEP.
+*/
+static void delay_until(int64_t deadline_ns) {
+    int64_t sleep_ns;
+
+    while ((sleep_ns = deadline_ns - bench_now_ns()) > 0) {
+#if defined _WIN32
+        Sleep((DWORD)((sleep_ns + 999999) / 1000000));
+#else
+        struct timespec ts;
+        ts.tv_sec = (time_t)(sleep_ns / 1000000000LL);
+        ts.tv_nsec = (long)(sleep_ns % 1000000000LL);
+        nanosleep(&ts, NULL);
+#endif
+    }
+}
+
+
+/*
+** File methods. The counted ones time the real call; xWrite and xSync
+** also add the simulated device's delay; the rest just pass the call on.
+*/
+static int io_close(sqlite3_file *file) {
+    bench_file_t *f = (bench_file_t *)file;
+    int rc = SQLITE_OK;
+
+    if (f->real->pMethods != NULL) {
+        rc = f->real->pMethods->xClose(f->real);
+    }
+    f->base.pMethods = NULL;
+    return rc;
+}
+
+static int io_read(sqlite3_file *file, void *buf, int amount, sqlite3_int64 offset) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    int rc = f->real->pMethods->xRead(f->real, buf, amount, offset);
+
+    count_io(f->file_type, BENCH_IO_READ, amount, start_ns);
+    return rc;
+}
+
+static int io_write(sqlite3_file *file, const void *buf, int amount, sqlite3_int64 offset) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    const bench_device_t *device = _device;
+    int rc = f->real->pMethods->xWrite(f->real, buf, amount, offset);
+
+    if (device != NULL && device->write_mbps > 0 && f->file_type != BENCH_IO_TEMP) {
+        delay_until(start_ns + (int64_t)amount * 1000 / device->write_mbps);
+    }
+    count_io(f->file_type, BENCH_IO_WRITE, amount, start_ns);
+    return rc;
+}
+
+static int io_truncate(sqlite3_file *file, sqlite3_int64 size) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    int rc = f->real->pMethods->xTruncate(f->real, size);
+
+    count_io(f->file_type, BENCH_IO_TRUNCATE, 0, start_ns);
+    return rc;
+}
+
+static int io_sync(sqlite3_file *file, int flags) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    const bench_device_t *device = _device;
+    int rc = f->real->pMethods->xSync(f->real, flags);
+
+    if (device != NULL && f->file_type != BENCH_IO_TEMP) {
+        delay_until(start_ns + (int64_t)device->sync_us * 1000);
+    }
+    count_io(f->file_type, BENCH_IO_SYNC, 0, start_ns);
+    return rc;
+}
+
+static int io_file_size(sqlite3_file *file, sqlite3_int64 *size) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    int rc = f->real->pMethods->xFileSize(f->real, size);
+
+    count_io(f->file_type, BENCH_IO_FILE_SIZE, 0, start_ns);
+    return rc;
+}
+
+static int io_lock(sqlite3_file *file, int lock) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    int rc = f->real->pMethods->xLock(f->real, lock);
+
+    count_io(f->file_type, BENCH_IO_LOCK, 0, start_ns);
+    return rc;
+}
+
+static int io_unlock(sqlite3_file *file, int lock) {
+    bench_file_t *f = (bench_file_t *)file;
+    int64_t start_ns = bench_now_ns();
+    int rc = f->real->pMethods->xUnlock(f->real, lock);
+
+    count_io(f->file_type, BENCH_IO_LOCK, 0, start_ns);
+    return rc;
+}
+
+static int io_check_reserved_lock(sqlite3_file *file, int *result) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xCheckReservedLock(f->real, result);
+}
+
+static int io_file_control(sqlite3_file *file, int op, void *arg) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xFileControl(f->real, op, arg);
+}
+
+static int io_sector_size(sqlite3_file *file) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xSectorSize(f->real);
+}
+
+static int io_device_characteristics(sqlite3_file *file) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xDeviceCharacteristics(f->real);
+}
+
+static int io_shm_map(sqlite3_file *file, int region, int size, int extend, void volatile **p) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xShmMap(f->real, region, size, extend, p);
+}
+
+static int io_shm_lock(sqlite3_file *file, int offset, int n, int flags) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xShmLock(f->real, offset, n, flags);
+}
+
+static void io_shm_barrier(sqlite3_file *file) {
+    bench_file_t *f = (bench_file_t *)file;
+    f->real->pMethods->xShmBarrier(f->real);
+}
+
+static int io_shm_unmap(sqlite3_file *file, int delete_flag) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xShmUnmap(f->real, delete_flag);
+}
+
+static int io_fetch(sqlite3_file *file, sqlite3_int64 offset, int amount, void **p) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xFetch(f->real, offset, amount, p);
+}
+
+static int io_unfetch(sqlite3_file *file, sqlite3_int64 offset, void *p) {
+    bench_file_t *f = (bench_file_t *)file;
+    return f->real->pMethods->xUnfetch(f->real, offset, p);
+}
+
+
+/*
+** Open the real file just after ours, and sort it into a file type by the
+** flags SQLite opened it with.
+*/
+static int vfs_open(sqlite3_vfs *vfs, const char *name, sqlite3_file *file, int flags, int *out_flags) {
+    bench_file_t *f = (bench_file_t *)file;
+    int rc;
+
+    (void)vfs;
+    memset(f, 0, sizeof(*f));
+    f->real = (sqlite3_file *)&f[1];
+
+    if (flags & SQLITE_OPEN_MAIN_DB) {
+        f->file_type = BENCH_IO_MAIN;
+    }
+    else if (flags & (SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_MASTER_JOURNAL)) {
+        f->file_type = BENCH_IO_JOURNAL;
+    }
+    else if (flags & SQLITE_OPEN_WAL) {
+        f->file_type = BENCH_IO_WAL;
+    }
+    else {
+        f->file_type = BENCH_IO_TEMP;
+    }
+
+    rc = _real_vfs->xOpen(_real_vfs, name, f->real, flags, out_flags);
+
+    /*
+    ** SQLite calls xClose even on a failed open if pMethods was set, so
+    ** mirror whatever the real VFS did.
+    */
+    if (f->real->pMethods != NULL) {
+        f->methods = _io_methods;
+        if (f->real->pMethods->iVersion < f->methods.iVersion) {
+            f->methods.iVersion = f->real->pMethods->iVersion;
+        }
+        f->base.pMethods = &f->methods;
+    }
+    return rc;
+}
+
+
+/*
+** VFS methods, all passed on to the real VFS.
+*/
+static int vfs_delete(sqlite3_vfs *vfs, const char *name, int sync_dir) {
+    (void)vfs;
+    return _real_vfs->xDelete(_real_vfs, name, sync_dir);
+}
+
+static int vfs_access(sqlite3_vfs *vfs, const char *name, int flags, int *result) {
+    (void)vfs;
+    return _real_vfs->xAccess(_real_vfs, name, flags, result);
+}
+
+static int vfs_full_pathname(sqlite3_vfs *vfs, const char *name, int out_size, char *out) {
+    (void)vfs;
+    return _real_vfs->xFullPathname(_real_vfs, name, out_size, out);
+}
+
+static void *vfs_dl_open(sqlite3_vfs *vfs, const char *filename) {
+    (void)vfs;
+    return _real_vfs->xDlOpen(_real_vfs, filename);
+}
+
+static void vfs_dl_error(sqlite3_vfs *vfs, int size, char *msg) {
+    (void)vfs;
+    _real_vfs->xDlError(_real_vfs, size, msg);
+}
+
+static void (*vfs_dl_sym(sqlite3_vfs *vfs, void *handle, const char *symbol))(void) {
+    (void)vfs;
+    return _real_vfs->xDlSym(_real_vfs, handle, symbol);
+}
+
+static void vfs_dl_close(sqlite3_vfs *vfs, void *handle) {
+    (void)vfs;
+    _real_vfs->xDlClose(_real_vfs, handle);
+}
+
+static int vfs_randomness(sqlite3_vfs *vfs, int size, char *out) {
+    (void)vfs;
+    return _real_vfs->xRandomness(_real_vfs, size, out);
+}
+
+static int vfs_sleep(sqlite3_vfs *vfs, int microseconds) {
+    (void)vfs;
+    return _real_vfs->xSleep(_real_vfs, microseconds);
+}
+
+static int vfs_current_time(sqlite3_vfs *vfs, double *now) {
+    (void)vfs;
+    return _real_vfs->xCurrentTime(_real_vfs, now);
+}
+
+static int vfs_get_last_error(sqlite3_vfs *vfs, int size, char *msg) {
+    (void)vfs;
+    return _real_vfs->xGetLastError(_real_vfs, size, msg);
+}
+
+static int vfs_current_time_int64(sqlite3_vfs *vfs, sqlite3_int64 *now) {
+    (void)vfs;
+    return _real_vfs->xCurrentTimeInt64(_real_vfs, now);
+}
+
+static int vfs_set_system_call(sqlite3_vfs *vfs, const char *name, sqlite3_syscall_ptr call) {
+    (void)vfs;
+    return _real_vfs->xSetSystemCall(_real_vfs, name, call);
+}
+
+static sqlite3_syscall_ptr vfs_get_system_call(sqlite3_vfs *vfs, const char *name) {
+    (void)vfs;
+    return _real_vfs->xGetSystemCall(_real_vfs, name);
+}
+
+static const char *vfs_next_system_call(sqlite3_vfs *vfs, const char *name) {
+    (void)vfs;
+    return _real_vfs->xNextSystemCall(_real_vfs, name);
+}
@@ -0,0 +1,72 @@
+/*
+** bench_vfs - A pass-through VFS that counts and times the file I/O SQLite
+** asks for.
+*/
+#ifndef BENCH_VFS_H
+#define BENCH_VFS_H
+
+#include <stdint.h>
+
+/*
+** What a file is used for, from the flags SQLite opened it with.
+*/
+#define BENCH_IO_MAIN 0
+#define BENCH_IO_JOURNAL 1
+#define BENCH_IO_WAL 2
+#define BENCH_IO_TEMP 3
+#define BENCH_IO_NUM_FILE_TYPES 4
+
+/*
+** The file methods counted. BENCH_IO_LOCK counts xLock and xUnlock.
+*/
+#define BENCH_IO_READ 0
+#define BENCH_IO_WRITE 1
+#define BENCH_IO_SYNC 2
+#define BENCH_IO_TRUNCATE 3
+#define BENCH_IO_FILE_SIZE 4
+#define BENCH_IO_LOCK 5
+#define BENCH_IO_NUM_OPS 6
+
+/*
+** Calls made, bytes asked for (xRead / xWrite only) and time spent in one
+** method for one type of file.
+*/
+typedef struct bench_io_stat_t {
+    int64_t calls;
+    int64_t bytes;
+    int64_t ns;
+} bench_io_stat_t;
+
+/*
+** Totals since the VFS was registered, for every file type and method.
+*/
+typedef struct bench_io_stats_t {
+    bench_io_stat_t stat[BENCH_IO_NUM_FILE_TYPES][BENCH_IO_NUM_OPS];
+} bench_io_stats_t;
+
+/*
+** A simulated storage device. Every xSync of a main database, journal or
+** WAL file takes sync_us, and every xWrite to one takes as long as
+** write_mbps (MB/s) allows for its bytes (no limit if 0), or as long as the
+** real I/O took if that is longer.
+*/
+typedef struct bench_device_t {
+    const char *id;
+    const char *description;
+    int sync_us;
+    int write_mbps;
+} bench_device_t;
+
+/*
+** Function prototypes.
+*/
+int bench_vfs_register();
+void bench_vfs_set_device(const bench_device_t *device);
+const bench_device_t *bench_device_find(const char *id);
+const bench_device_t *bench_device_models(int *count);
+void bench_vfs_sample(bench_io_stats_t *stats);
+void bench_vfs_diff(const bench_io_stats_t *start, const bench_io_stats_t *end, bench_io_stats_t *elapsed);
+const char *bench_io_file_type_name(int file_type);
+const char *bench_io_op_name(int op);
+
+#endif
@@ -0,0 +1,241 @@
+/*
+** ingest_queue - Many producer threads, one SQLite writer, group commit.
+**
+** The queue is Dmitry Vyukov's intrusive MPSC list: a push is one atomic
+** exchange on head plus a store to the old head's next pointer, so producers
+** never wait on each other or on the writer. Only the writer pops.
+*/
+#include "ingest_queue.h"
+#include "bench.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INGEST_KEY_SIZE 25
+
+
+/*
+** Function prototypes.
+*/
+static void writer_main(void *arg);
+static ingest_row_t *queue_pop(ingest_queue_t *queue);
+static void commit_batch(ingest_queue_t *queue, int num_rows);
+
+
+/*
+** Start the writer thread on db, which must already hold the Test table and
+** must not be used by anyone else until ingest_queue_stop(). A transaction is
+** committed when it reaches max_rows rows or has been open for at least
+** max_delay_ns. A delay of 0 instead commits as soon as the writer catches
+** up with the producers, so only max_rows bounds it while they keep up.
+*/
+void ingest_queue_start(ingest_queue_t *queue, sqlite3 *db, int max_rows, int64_t max_delay_ns) {
+    memset(queue, 0, sizeof(*queue));
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+    queue->db = db;
+    queue->max_rows = max_rows;
+    queue->max_delay_ns = max_delay_ns;
+    bench_hist_init(&queue->commit_latency, 0);
+
+    queue->batch = malloc(sizeof(*queue->batch) * max_rows);
+    if (queue->batch == NULL) {
+        printf("Out of memory allocating a %d row ingest batch.\n", max_rows);
+        exit(-1);
+    }
+
+    if (bench_thread_start(&queue->writer, writer_main, queue) != 0) {
+        printf("Unable to start the ingest writer thread.\n");
+        exit(-1);
+    }
+}
+
+
+/*
+** Queue one row. Safe to call from any number of threads at once.
+*/
+void ingest_queue_push(ingest_queue_t *queue, ingest_row_t *row) {
+    ingest_row_t *prev;
+
+    row->next = NULL;
+    prev = bench_atomic_xchg_ptr(&queue->head, row);
+    bench_atomic_store_ptr(&prev->next, row);
+}
+
+
+/*
+** Wait until every row pushed against ticket has been committed.
+*/
+void ingest_queue_wait(ingest_ticket_t *ticket) {
+    while (bench_atomic_load(&ticket->pending) > 0) {
+        bench_thread_yield();
+    }
+}
+
+
+/*
+** Commit whatever is left and stop the writer. Every producer must have
+** finished pushing first.
+*/
+void ingest_queue_stop(ingest_queue_t *queue) {
+    bench_atomic_store(&queue->closed, 1);
+    bench_thread_join(&queue->writer);
+}
+
+
+/*
+** Release the memory held by a stopped queue.
+*/
+void ingest_queue_free(ingest_queue_t *queue) {
+    bench_hist_free(&queue->commit_latency);
+    free(queue->batch);
+    queue->batch = NULL;
+}
+
+
+/*
+** The single writer: the prepared insert loop of insert_rows_xact_prepared,
+** fed from the queue instead of a counter. BEGIN is issued on the first row
+** of a batch, so an idle queue holds no transaction open.
+*/
+static void writer_main(void *arg) {
+    ingest_queue_t *queue = (ingest_queue_t *)arg;
+    const char *sql;
+    char key[INGEST_KEY_SIZE];
+    sqlite3_stmt *stmt;
+    ingest_row_t *row;
+    int rc;
+    int closed;
+    int key_len;
+    int num_rows = 0;
+    int64_t batch_start = 0;
+
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(queue->db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(queue->db);
+    }
+
+    for (;;) {
+        /*
+        ** closed is read before popping: if it was already set, every push
+        ** has finished, so an empty pop really means the queue is drained.
+        */
+        closed = bench_atomic_load(&queue->closed);
+        row = queue_pop(queue);
+
+        if (row == NULL) {
+            if (num_rows > 0 && (closed || bench_now_ns() - batch_start >= queue->max_delay_ns)) {
+                commit_batch(queue, num_rows);
+                num_rows = 0;
+            }
+            else if (closed) {
+                break;
+            }
+            else {
+                ++queue->empty_polls;
+                bench_thread_yield();
+            }
+            continue;
+        }
+
+        if (num_rows == 0) {
+            rc = sqlite3_exec(queue->db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+            if (rc != SQLITE_OK) {
+                die_conn_error(queue->db);
+            }
+            batch_start = bench_now_ns();
+        }
+
+        key_len = sprintf(key, "K-%d", row->id);
+        sqlite3_bind_text(stmt, 1, key, key_len, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 2, row->num1);
+        sqlite3_bind_double(stmt, 3, row->num2);
+        sqlite3_bind_double(stmt, 4, row->num3);
+        sqlite3_bind_double(stmt, 5, row->num4);
+
+        rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            die_conn_error(queue->db);
+        }
+        sqlite3_reset(stmt);
+
+        /*
+        ** The age is checked here as well as on an empty pop, so a steady
+        ** stream that never drains the queue can't hold a transaction open
+        ** past the delay.
+        */
+        queue->batch[num_rows++] = row;
+        if (num_rows == queue->max_rows
+            || (queue->max_delay_ns > 0 && bench_now_ns() - batch_start >= queue->max_delay_ns)) {
+            commit_batch(queue, num_rows);
+            num_rows = 0;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+
+/*
+** Pop the oldest row, or NULL if the queue is empty or the newest push is
+** still half done (head swapped but next not yet linked); either way the
+** writer simply tries again later.
+*/
+static ingest_row_t *queue_pop(ingest_queue_t *queue) {
+    ingest_row_t *tail = queue->tail;
+    ingest_row_t *next = bench_atomic_load_ptr(&tail->next);
+
+    if (tail == &queue->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = bench_atomic_load_ptr(&tail->next);
+    }
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+    if (tail != bench_atomic_load_ptr(&queue->head)) {
+        return NULL;
+    }
+
+    /*
+    ** tail is the last row. Put the stub back behind it so tail can be
+    ** handed out without leaving the list empty.
+    */
+    ingest_queue_push(queue, &queue->stub);
+    next = bench_atomic_load_ptr(&tail->next);
+    if (next != NULL) {
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+
+/*
+** COMMIT the open transaction and complete the tickets of its rows. A row
+** must not be touched once its ticket drops, as the producer may reuse it.
+*/
+static void commit_batch(ingest_queue_t *queue, int num_rows) {
+    int64_t start_ns;
+    int rc;
+
+    start_ns = bench_now_ns();
+    rc = sqlite3_exec(queue->db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    bench_hist_record(&queue->commit_latency, start_ns, bench_now_ns());
+    if (rc != SQLITE_OK) {
+        die_conn_error(queue->db);
+    }
+
+    queue->rows += num_rows;
+    ++queue->commits;
+
+    for (int i = 0; i < num_rows; ++i) {
+        bench_atomic_add(&queue->batch[i]->ticket->pending, -1);
+    }
+}
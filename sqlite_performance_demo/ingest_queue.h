@@ -0,0 +1,78 @@
+/*
+** ingest_queue - Many producer threads, one SQLite writer, group commit.
+**
+** Producers push rows onto a lock-free multi-producer / single-consumer
+** queue. One writer thread pops them and inserts them into the Test table
+** with a prepared statement, committing a transaction once it holds max_rows
+** rows or is max_delay_ns old, whether or not the queue has run dry. Waiting
+** out the delay lets more producers join the commit, and bounds how long a
+** row waits under a steady stream. Every row points at a ticket; when the
+** transaction holding a row commits, its ticket's pending count drops, so a
+** producer can wait for exactly its own rows to be durable.
+*/
+#ifndef INGEST_QUEUE_H
+#define INGEST_QUEUE_H
+
+#include "sqlite3.h"
+#include "bench_hist.h"
+#include "bench_thread.h"
+#include <stdint.h>
+
+/*
+** Completion notification for a group of rows. Set pending to the number of
+** rows before pushing them; it reaches 0 once all of them are committed.
+*/
+typedef struct ingest_ticket_t {
+    int pending;
+} ingest_ticket_t;
+
+/*
+** One queued row. Owned by the producer, and must stay valid until its
+** ticket completes.
+*/
+typedef struct ingest_row_t {
+    struct ingest_row_t *next;
+    ingest_ticket_t *ticket;
+    int id;
+    double num1;
+    double num2;
+    double num3;
+    double num4;
+} ingest_row_t;
+
+/*
+** The queue and its writer. head is where producers push, tail (and
+** everything after it) belongs to the writer. stub keeps the list from ever
+** being empty, so push never has to touch tail.
+*/
+typedef struct ingest_queue_t {
+    ingest_row_t *head;
+    ingest_row_t *tail;
+    ingest_row_t stub;
+    int closed;
+
+    sqlite3 *db;
+    int max_rows;
+    int64_t max_delay_ns;
+    bench_thread_t writer;
+    ingest_row_t **batch;
+
+    /*
+    ** Writer statistics, only valid after ingest_queue_stop().
+    */
+    int64_t rows;
+    int64_t commits;
+    int64_t empty_polls;
+    bench_hist_t commit_latency;
+} ingest_queue_t;
+
+/*
+** Function prototypes.
+*/
+void ingest_queue_start(ingest_queue_t *queue, sqlite3 *db, int max_rows, int64_t max_delay_ns);
+void ingest_queue_push(ingest_queue_t *queue, ingest_row_t *row);
+void ingest_queue_wait(ingest_ticket_t *ticket);
+void ingest_queue_stop(ingest_queue_t *queue);
+void ingest_queue_free(ingest_queue_t *queue);
+
+#endif
@@ -3,32 +3,58 @@
 ** data in a SQLite database.
 */
 #include "sqlite3.h"
+#include "bench.h"
+#include "bench_timer.h"
+#include "bench_perf.h"
+#include "bench_vfs.h"
+#include "bench_rand.h"
+#include "bench_report.h"
+#include "bench_thread.h"
+#include "test_concurrent.h"
+#include "test_sharded.h"
+#include "test_ingest.h"
+#include "test_sweep.h"
+#include "test_index.h"
+#include "test_sort.h"
+#include "test_scan.h"
+#include "test_batch.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
-#include <time.h>
 
 /*
-** Enable these macros to exeucte PRAGMA commands before running a test function.
+** Enable PAUSE_ON_EXIT to wait for a key press before the process exits. The
+** Visual Studio project defines this so the console window stays open; the
+** CMake build leaves it off so the benchmark can run unattended.
 */
-// #define PRAGMA_JOURNAL_MEM
-
-
-#define DB_FILE_PATH "test.db"
-#define NUM_EXECUTIONS 10000000
-#define RAND_DOUBLE_LIMIT 100.0
-#define DASHES "----------------------------------------"
+// #define PAUSE_ON_EXIT
 
 
 /*
-** Enable MEMORY_MODE macro to use SQLite in RAM.
+** Defaults for the command line options. See print_usage() for the options
+** that override these.
 */
-// #define MEMORY_MODE
+#define DEFAULT_DB_FILE_PATH "test.db"
+#define DEFAULT_NUM_ROWS 10000000
+#define DEFAULT_SERIES_INTERVAL_MS 100
+#define DEFAULT_SEED 1
+#define DEFAULT_BATCH_ROWS 50
+#define DEFAULT_SHARDS 0
+#define DEFAULT_READERS 4
+#define DEFAULT_WRITERS 1
+#define DEFAULT_PRODUCERS 4
+#define DEFAULT_GROUP_ROWS 1000
+#define DEFAULT_GROUP_DELAY_US 0
+#define DEFAULT_SORTER_THREADS -1
+#define DEFAULT_DEVICE_VALUE -1
+#define DEFAULT_SCHEMAS "rowid"
+#define MEMORY_DB_FILE_PATH ":memory:"
+#define RAND_DOUBLE_LIMIT 100.0
+#define MICRO_REPEATS 3
+#define DASHES "----------------------------------------"
 
-#if defined MEMORY_MODE
-    #define DB_FILE_PATH ":memory:"
-#endif
 
 /*
 ** Structure of test table rows.
@@ -46,18 +72,64 @@ typedef struct test_t {
 /*
 ** Function prototypes.
 */
-void die_db_error();
+void die_usage(const char *fmt, const char *arg);
+void pause_on_exit();
+void print_usage(const char *prog);
+void parse_args(int argc, char **argv);
+int is_integer(const char *text);
+int test_selected(const test_case_t *test);
+int list_contains(const char *list, const char *id);
+void run_tests();
 void open_database();
 void close_database();
+void read_pragmas(bench_pragmas_t *pragmas);
+int64_t query_int64(const char *sql);
 void setup_test();
+void create_test_table(sqlite3 *db);
+void create_schema_table(sqlite3 *db, const char *schema_id);
 void setup_update_test();
-void time_test_execution(const char *test_name, void(*fun)(), void(*setup_fun)());
-double rand_double();
+void time_test_execution(const test_case_t *test, test_result_t *result);
+void add_perf_metrics(const bench_perf_counts_t *counts, int64_t rows);
+void add_io_metrics(const bench_io_stats_t *start, const bench_io_stats_t *end, int64_t rows);
+void reset_sqlite_status();
+void add_sqlite_status_metrics(int64_t rows);
+void print_result(const char *test_name, const test_result_t *result);
+void print_result_header();
+void print_latency_table(const char *group);
+void print_latency_series(const char *test_name, const bench_hist_t *hist);
+void print_metrics(const char *group);
+void build_dataset();
+void free_dataset();
 void insert_rows();
 void insert_rows_xact();
 void insert_rows_xact_prepared();
+void insert_rows_xact_prepared_lean();
+void insert_rows_xact_prepared_ex(int clear_bindings);
+void insert_rows_xact_multirow();
+sqlite3_stmt *prepare_multirow_insert(int rows);
+void setup_key_arena_test();
+void setup_key_arena_batch_test();
+void setup_sorted_test();
+void setup_without_rowid_test();
+void setup_without_rowid_sorted_test();
+void build_key_arena();
+void sort_key_arena();
+void build_key_batch_offsets();
+int compare_arena_keys(const void *a, const void *b);
+void free_key_arena();
+void insert_rows_arena_static();
+void insert_rows_arena_transient();
+void insert_rows_arena_sorted();
+void insert_rows_arena(sqlite3_destructor_type key_destructor, const int *order);
+void insert_rows_arena_batch();
 void update_rows_pk();
+void update_rows_pk_lean();
+void update_rows_pk_ex(int clear_bindings);
 void update_rows_rowid();
+void update_rows_rowid_lean();
+void update_rows_rowid_ex(int clear_bindings);
+void bind_reset_micro();
+int64_t time_bind_loop(sqlite3_stmt *stmt, int n, int clear_bindings);
 
 
 /*
@@ -66,307 +138,2085 @@ void update_rows_rowid();
 */
 static sqlite3 *_db;
 
+/*
+** Path _db was opened with, for tests that open extra connections.
+*/
+static const char *_db_path;
+
+/*
+** The storage device simulated by the bench_io VFS: the --device model
+** with any --sync-us / --write-mbps overrides, or just the overrides as a
+** "custom" device. Only used when device.id is set.
+*/
+static bench_device_t _device;
+
+/*
+** Global benchmark configuration. Only written by parse_args(), apart from
+** schema, which main() sets for each --schema pass and
+** create_schema_table() for the test it is creating a table for.
+*/
+static bench_config_t _config = {
+    DEFAULT_NUM_ROWS,
+    DEFAULT_DB_FILE_PATH,
+    0,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    DEFAULT_SCHEMAS,
+    NULL,
+    1,
+    0,
+    DEFAULT_SERIES_INTERVAL_MS,
+    DEFAULT_SEED,
+    DEFAULT_BATCH_ROWS,
+    DEFAULT_SHARDS,
+    DEFAULT_READERS,
+    DEFAULT_WRITERS,
+    DEFAULT_PRODUCERS,
+    DEFAULT_GROUP_ROWS,
+    DEFAULT_GROUP_DELAY_US,
+    DEFAULT_SORTER_THREADS,
+    0,
+    0,
+    NULL,
+    NULL,
+    DEFAULT_DEVICE_VALUE,
+    DEFAULT_DEVICE_VALUE,
+    NULL,
+    NULL
+};
+
+/*
+** All of the available tests, in the order they are run. Inserting without a
+** transaction is off by default because it will take way to long with higher
+** numbers of rows.
+*/
+static const test_case_t _tests[] = {
+    { "insert",                "Insert Rows (no xact)",          "INSERTS",     insert_rows,                    setup_test,                      0, 0, 0 },
+    { "insert_xact",           "Insert Rows (xact)",             "INSERTS",     insert_rows_xact,               setup_test,                      1, 0, 0 },
+    { "insert_xact_prep",      "Insert Rows (xact, prep)",       "INSERTS",     insert_rows_xact_prepared,      setup_test,                      1, 0, 0 },
+    { "insert_xact_lean",      "Insert Rows (xact, lean)",       "INSERTS",     insert_rows_xact_prepared_lean, setup_test,                      1, 0, 0 },
+    { "insert_multirow",       "Insert Rows (multi-row)",        "INSERTS",     insert_rows_xact_multirow,      setup_test,                      1, 0, 0 },
+    { "insert_arena",          "Insert Rows (arena, static)",    "INSERTS",     insert_rows_arena_static,       setup_key_arena_test,            1, 0, 0 },
+    { "insert_arena_copy",     "Insert Rows (arena, copy)",      "INSERTS",     insert_rows_arena_transient,    setup_key_arena_test,            0, 0, 0 },
+    { "insert_arena_batch",    "Insert Rows (arena, batch)",     "INSERTS",     insert_rows_arena_batch,        setup_key_arena_batch_test,      0, 0, 0 },
+    { "insert_sharded",        "Insert Rows (sharded)",          "INSERTS",     insert_sharded,                 setup_test,                      0, 1, 0 },
+    { "insert_xact_sweep",     "Insert Rows (commit sweep)",     "INSERTS",     insert_xact_sweep,              setup_test,                      0, 1, 0 },
+    { "insert_sorted",         "Insert Rows (arena, sorted)",    "INSERTS",     insert_rows_arena_sorted,       setup_sorted_test,               0, 0, 0 },
+    { "insert_norowid",        "Insert (WITHOUT ROWID)",         "INSERTS",     insert_rows_arena_static,       setup_without_rowid_test,        0, 0, NEEDS_OWN_TABLE },
+    { "insert_norowid_sorted", "Insert (WITHOUT ROWID, sorted)", "INSERTS",     insert_rows_arena_sorted,       setup_without_rowid_sorted_test, 0, 0, NEEDS_OWN_TABLE },
+    { "index_deferred",        "Insert, then CREATE INDEX",      "INDEXES",     index_deferred,                 setup_deferred_index_test,       0, 0, NEEDS_OWN_TABLE },
+    { "index_maintained",      "Insert (index maintained)",      "INDEXES",     index_maintained,               setup_maintained_index_test,     0, 0, NEEDS_OWN_TABLE },
+    { "sort_sweep",            "Sort (threads, cache, temp)",    "SORTS",       sort_sweep,                     setup_update_test,               0, 0, 0 },
+    { "scan_table",            "Scan (table order)",             "SCANS",       scan_table,                     setup_update_test,               0, 0, 0 },
+    { "scan_index",            "Scan (key index order)",         "SCANS",       scan_index,                     setup_update_test,               0, 0, NEEDS_KEY_INDEX },
+    { "scan_covering",         "Scan (covering key index)",      "SCANS",       scan_covering,                  setup_update_test,               0, 0, NEEDS_KEY_INDEX },
+    { "scan_aggregate",        "Scan (SUM/AVG)",                 "SCANS",       scan_aggregate,                 setup_update_test,               0, 0, 0 },
+    { "scan_decode",           "Scan (decode breakdown)",        "SCANS",       scan_decode,                    setup_update_test,               0, 0, 0 },
+    { "fetch_rows",            "Fetch (sqlite3_column_*)",       "FETCHES",     fetch_rows,                     setup_update_test,               0, 0, NEEDS_ROWID },
+    { "fetch_batch",           "Fetch (sqlite3_step_batch)",     "FETCHES",     fetch_batch,                    setup_update_test,               0, 0, NEEDS_ROWID },
+    { "update_pk",             "Update Rows PK",                 "UPDATES",     update_rows_pk,                 setup_update_test,               1, 0, NEEDS_KEY_INDEX },
+    { "update_rowid",          "Update Rows ROWID",              "UPDATES",     update_rows_rowid,              setup_update_test,               1, 0, NEEDS_ROWID },
+    { "update_pk_lean",        "Update Rows PK (lean)",          "UPDATES",     update_rows_pk_lean,            setup_update_test,               1, 0, NEEDS_KEY_INDEX },
+    { "update_rowid_lean",     "Update Rows ROWID (lean)",       "UPDATES",     update_rows_rowid_lean,         setup_update_test,               1, 0, NEEDS_ROWID },
+    { "bind_reset",            "Bind/Reset Overhead",            "MICRO",       bind_reset_micro,               setup_test,                      0, 0, 0 },
+    { "ingest_group",          "Ingest (queue, group commit)",   "INGEST",      ingest_group,                   setup_test,                      0, 0, 0 },
+    { "ingest_naive",          "Ingest (per-thread commit)",     "INGEST",      ingest_naive,                   setup_test,                      0, 1, 0 },
+    { "wal_concurrent",        "WAL Readers + Writers",          "CONCURRENCY", concurrent_wal,                 setup_concurrent_test,           0, 1, NEEDS_ROWID },
+};
+
+#define NUM_TESTS (sizeof(_tests) / sizeof(_tests[0]))
+
+/*
+** Layouts of the Test table that --schema can choose between. rowid is the
+** original: a rowid table plus the sqlite_autoindex for the TEXT primary key,
+** so every insert writes two btrees. The SQL is run by create_test_table().
+*/
+typedef struct schema_t {
+    const char *id;
+    const char *description;
+    const char *sql;
+    int provides;
+} schema_t;
+
+static const schema_t _schemas[] = {
+    { "rowid", "rowid table, TEXT PRIMARY KEY index",
+        "CREATE TABLE IF NOT EXISTS Test(key TEXT, num1 FLOAT, num2 FLOAT, num3 FLOAT, num4 FLOAT, "
+        "PRIMARY KEY(key) );",
+        NEEDS_ROWID | NEEDS_KEY_INDEX },
+    { "without_rowid", "WITHOUT ROWID, rows stored in the key btree",
+        "CREATE TABLE IF NOT EXISTS Test(key TEXT, num1 FLOAT, num2 FLOAT, num3 FLOAT, num4 FLOAT, "
+        "PRIMARY KEY(key) ) WITHOUT ROWID;",
+        NEEDS_KEY_INDEX },
+    { "int_pk", "INTEGER PRIMARY KEY, separate unique key index",
+        "CREATE TABLE IF NOT EXISTS Test(id INTEGER PRIMARY KEY, key TEXT, num1 FLOAT, num2 FLOAT, num3 FLOAT, "
+        "num4 FLOAT );"
+        "CREATE UNIQUE INDEX IF NOT EXISTS TestKey ON Test(key);",
+        NEEDS_ROWID | NEEDS_KEY_INDEX },
+    { "no_index", "rowid table, no index on key",
+        "CREATE TABLE IF NOT EXISTS Test(key TEXT, num1 FLOAT, num2 FLOAT, num3 FLOAT, num4 FLOAT );",
+        NEEDS_ROWID },
+};
+
+#define NUM_SCHEMAS (sizeof(_schemas) / sizeof(_schemas[0]))
+
+/*
+** sqlite3_db_status() counters reported per 1,000 rows for every test.
+** The lookaside ones only have a high-water value, which is their count.
+*/
+typedef struct db_status_counter_t {
+    int op;
+    const char *name;
+    int use_highwater;
+} db_status_counter_t;
+
+static const db_status_counter_t _db_status_counters[] = {
+    { SQLITE_DBSTATUS_CACHE_HIT,           "cache_hit_per_1k",           0 },
+    { SQLITE_DBSTATUS_CACHE_MISS,          "cache_miss_per_1k",          0 },
+    { SQLITE_DBSTATUS_CACHE_WRITE,         "cache_write_per_1k",         0 },
+    { SQLITE_DBSTATUS_CACHE_SPILL,         "cache_spill_per_1k",         0 },
+    { SQLITE_DBSTATUS_LOOKASIDE_HIT,       "lookaside_hit_per_1k",       1 },
+    { SQLITE_DBSTATUS_LOOKASIDE_MISS_SIZE, "lookaside_miss_size_per_1k", 1 },
+    { SQLITE_DBSTATUS_LOOKASIDE_MISS_FULL, "lookaside_miss_full_per_1k", 1 },
+};
+
+#define NUM_DB_STATUS_COUNTERS (sizeof(_db_status_counters) / sizeof(_db_status_counters[0]))
+
+/*
+** Every key "K-0" ... "K-<rows - 1>" formatted back to back into one buffer
+** (no NUL terminators). Key i is bytes[offsets[i]] to bytes[offsets[i + 1]].
+** Built once, outside of any timed section, by build_key_arena(). sorted is
+** the row numbers in key order, only built (by sort_key_arena()) for the
+** tests that load in that order. batch_offsets is offsets as the int array
+** sqlite3_exec_batch() takes, only built (by build_key_batch_offsets()) for
+** insert_rows_arena_batch.
+*/
+typedef struct key_arena_t {
+    char *bytes;
+    size_t *offsets;
+    int *batch_offsets;
+    int *sorted;
+    int num_keys;
+    double build_sec;
+    double sort_sec;
+} key_arena_t;
+
+static key_arena_t _keys;
+
+/*
+** The num1 - num4 values for every row, generated from --seed before any
+** test is timed. See build_dataset().
+*/
+static bench_dataset_t _data;
+
+/*
+** Results for each entry in _tests, and the result and latency histogram of
+** the test that is currently running (NULL outside of the timed section).
+*/
+static test_result_t _results[NUM_TESTS];
+static test_result_t *_result;
+static bench_hist_t *_latency;
+
+/*
+** The --schema entry of the current pass over the tests, and how many passes
+** came before it.
+*/
+static const schema_t *_schema;
+static int _schema_pass;
+
 /*
 ** Test entry point: Test the various cases.
 */
-void main() {
-    printf("SQLite Performance Demo\n");
-    printf("Testing with %d rows.\n\n", NUM_EXECUTIONS);
+int main(int argc, char **argv) {
+    parse_args(argc, argv);
+    bench_report_open(&_config);
 
     /*
-    ** INSERT tests.
+    ** --vfs replaces the default VFS, so it is the one under every
+    ** connection and the one the bench_io VFS wraps.
     */
-    printf("TESTING INSERTS\n");
-    printf("%-30s %-15s %-15s\n", "Test", "Time (sec)", "Rows/sec");
-    printf("%.30s %.15s %.15s\n", DASHES, DASHES, DASHES);
-    //time_test_execution("Insert Rows (no xact)", insert_rows, setup_test); // This will take way to long with higher numbers.
-    printf("%30s %15s %15s\n", "Insert Rows (no xact)", "ommitted", "ommitted");
-    time_test_execution("Insert Rows (xact)", insert_rows_xact, setup_test);
-    time_test_execution("Insert Rows (xact, prep)", insert_rows_xact_prepared, setup_test);
+    if (_config.vfs != NULL && sqlite3_vfs_register(sqlite3_vfs_find(_config.vfs), 1) != SQLITE_OK) {
+        printf("Failed to make %s the default VFS.\n", _config.vfs);
+        exit(-1);
+    }
+    if ((_config.io_stats || _config.device != NULL) && bench_vfs_register() != SQLITE_OK) {
+        printf("Failed to register the I/O counting VFS.\n");
+        exit(-1);
+    }
+    if (_config.device != NULL) {
+        bench_vfs_set_device(&_device);
+    }
 
-    printf("\n");
+    printf("SQLite Performance Demo\n");
+    printf("Testing with %d rows", _config.num_rows);
+    printf(" in %s", _config.memory_mode ? "memory" : _config.db_path);
+    printf(" (journal_mode=%s, synchronous=%s, page_size=%s, cache_size=%s, mmap_size=%s).\n\n",
+        _config.journal_mode ? _config.journal_mode : "default",
+        _config.synchronous ? _config.synchronous : "default",
+        _config.page_size ? _config.page_size : "default",
+        _config.cache_size ? _config.cache_size : "default",
+        _config.mmap_size ? _config.mmap_size : "default");
+    if (_config.vfs != NULL) {
+        printf("Using the %s VFS.\n\n", _config.vfs);
+    }
+    if (_config.device != NULL) {
+        printf("Simulating device %s: %d us per sync, %d MB/s writes (0 = unlimited).\n\n",
+            _device.id, _device.sync_us, _device.write_mbps);
+    }
 
     /*
-    ** UPDATE tests.
+    ** One pass over the selected tests for each selected schema.
     */
-    printf("TESTING UPDATES\n");
-    printf("%-30s %-15s %-15s\n", "Test", "Time (sec)", "Rows/sec");
-    printf("%.30s %.15s %.15s\n", DASHES, DASHES, DASHES);
-    time_test_execution("Update Rows PK", update_rows_pk, setup_update_test);
-    time_test_execution("Update Rows ROWID", update_rows_rowid, setup_update_test);
+    for (size_t s = 0; s < NUM_SCHEMAS; ++s) {
+        if (strcmp(_config.schemas, "all") != 0 && !list_contains(_config.schemas, _schemas[s].id)) {
+            continue;
+        }
+        _schema = &_schemas[s];
+        _config.schema = _schema->id;
+
+        printf("SCHEMA %s (%s)\n\n", _schema->id, _schema->description);
+        run_tests();
+        printf("\n\n");
+        ++_schema_pass;
+    }
+
+    bench_report_close();
+    free_key_arena();
+    free_dataset();
 
-    printf("\n\n");
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        bench_hist_free(&_results[i].latency);
+    }
 
     printf("Tests completed.\n");
-    printf("PRESS ANY KEY TO EXIT\n");
+    pause_on_exit();
+    return 0;
+}
+
+
+/*
+** Run every selected test once against the current schema, printing the
+** results a group at a time. Results of an earlier pass are thrown away.
+*/
+void run_tests() {
+    const char *group = NULL;
+
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        bench_hist_free(&_results[i].latency);
+        memset(&_results[i], 0, sizeof(_results[i]));
+    }
+
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        if (!test_selected(&_tests[i])) {
+            continue;
+        }
+
+        /*
+        ** Print a table header whenever a new group of tests starts.
+        */
+        if (group == NULL || strcmp(group, _tests[i].group) != 0) {
+            if (group != NULL) {
+                print_latency_table(group);
+                print_metrics(group);
+                printf("\n");
+            }
+            group = _tests[i].group;
+            printf("TESTING %s\n", group);
+            print_result_header();
+        }
+
+        if (_tests[i].needs_file && _config.memory_mode) {
+            _results[i].skipped = 1;
+            printf("%30s skipped (needs a database file, not --memory)\n", _tests[i].name);
+            continue;
+        }
+        if ((_tests[i].needs_schema & NEEDS_OWN_TABLE) && _schema_pass > 0) {
+            _results[i].skipped = 1;
+            printf("%30s skipped (creates its own table, run in the first --schema pass)\n", _tests[i].name);
+            continue;
+        }
+        if ((_tests[i].needs_schema & _schema->provides & ~NEEDS_OWN_TABLE)
+            != (_tests[i].needs_schema & ~NEEDS_OWN_TABLE)) {
+            _results[i].skipped = 1;
+            printf("%30s skipped (needs %s, not --schema %s)\n", _tests[i].name,
+                (_tests[i].needs_schema & ~_schema->provides & NEEDS_ROWID) ? "a rowid" : "an index on key",
+                _schema->id);
+            continue;
+        }
+
+        time_test_execution(&_tests[i], &_results[i]);
+        print_result(_tests[i].name, &_results[i]);
+        bench_report_write(&_config, &_tests[i], &_results[i]);
+        _config.schema = _schema->id;
+    }
+
+    if (group != NULL) {
+        print_latency_table(group);
+        print_metrics(group);
+    }
+}
+
+
+/*
+** Print a message and exit if there is a critical database error. 
+*/
+void die_db_error() {
+    die_conn_error(_db);
+}
+
+
+/*
+** Same as die_db_error(), for a connection other than the global one (e.g.
+** one owned by a worker thread).
+*/
+void die_conn_error(sqlite3 *db) {
+    const char *msg;
+    msg = sqlite3_errmsg(db);
+    printf("SQLite Error - %s\n", msg);
+    pause_on_exit();
+    exit(-1);
+}
+
+
+/*
+** Print a message about bad command line usage and exit. "fmt" may contain
+** one %s, which is replaced with "arg".
+*/
+void die_usage(const char *fmt, const char *arg) {
+    fprintf(stderr, fmt, arg);
+    fprintf(stderr, "\nRun with --help for usage.\n");
+    exit(2);
+}
+
+
+/*
+** Wait for a key press if PAUSE_ON_EXIT is enabled. Otherwise a no-op.
+*/
+void pause_on_exit() {
+#if defined PAUSE_ON_EXIT
+    printf("PRESS ANY KEY TO EXIT.\n");
     getchar();
+#endif
+}
+
+
+/*
+** Print the command line options.
+*/
+void print_usage(const char *prog) {
+    const bench_device_t *models;
+    int num_models;
+
+    printf("Usage: %s [options]\n\n", prog);
+    printf("Options:\n");
+    printf("  --rows N              Number of rows to insert/update (default %d).\n", DEFAULT_NUM_ROWS);
+    printf("  --db PATH             Database file path (default \"%s\"). The file is deleted\n", DEFAULT_DB_FILE_PATH);
+    printf("                        before each test.\n");
+    printf("  --memory              Use an in-memory database instead of a file.\n");
+    printf("  --journal-mode MODE   PRAGMA journal_mode (DELETE, TRUNCATE, PERSIST, MEMORY, WAL, OFF).\n");
+    printf("  --synchronous MODE    PRAGMA synchronous (OFF, NORMAL, FULL, EXTRA).\n");
+    printf("  --page-size N         PRAGMA page_size in bytes.\n");
+    printf("  --cache-size N        PRAGMA cache_size (pages, or KiB if negative).\n");
+    printf("  --mmap-size N         PRAGMA mmap_size in bytes.\n");
+    printf("  --tests LIST          Comma separated test ids to run, or \"all\".\n");
+    printf("  --schema LIST         Comma separated Test table layouts to run every test\n");
+    printf("                        against, or \"all\" (default \"%s\").\n", DEFAULT_SCHEMAS);
+    printf("                        insert_norowid* and index_* use their own layout and\n");
+    printf("                        only run in the first pass.\n");
+    printf("  --no-latency          Don't time individual statements (no latency percentiles).\n");
+    printf("  --latency-series      Print the latency-over-time series for each test.\n");
+    printf("  --series-interval-ms N\n");
+    printf("                        Interval of the latency-over-time series (default %d).\n", DEFAULT_SERIES_INTERVAL_MS);
+    printf("  --seed N              Seed for the generated row data (default %d).\n", DEFAULT_SEED);
+    printf("  --batch-rows N        Rows per INSERT for insert_multirow (default %d).\n", DEFAULT_BATCH_ROWS);
+    printf("  --shards N            Most database files for insert_sharded (default: CPU count).\n");
+    printf("  --readers N           Reader threads for the concurrent tests (default %d).\n", DEFAULT_READERS);
+    printf("  --writers N           Writer threads for the concurrent tests (default %d).\n", DEFAULT_WRITERS);
+    printf("  --producers N         Producer threads for the ingest tests (default %d).\n", DEFAULT_PRODUCERS);
+    printf("  --group-rows N        Most rows per ingest_group commit (default %d).\n", DEFAULT_GROUP_ROWS);
+    printf("  --group-delay-us N    Longest an ingest_group transaction stays open waiting\n");
+    printf("                        for more rows (default %d).\n", DEFAULT_GROUP_DELAY_US);
+    printf("  --sorter-threads N    PRAGMA threads for index_deferred's CREATE INDEX, and\n");
+    printf("                        the only thread count sort_sweep runs (default: CPU count).\n");
+    printf("  --perf                Count CPU cycles, instructions, cache and branch misses\n");
+    printf("                        and context switches per row (Linux perf_event_open).\n");
+    printf("  --io-stats            Count and time the reads, writes, syncs, truncates,\n");
+    printf("                        size checks and locks of each type of file.\n");
+    printf("  --vfs NAME            Open every database through this VFS, e.g. unix-uring\n");
+    printf("                        or unix-uring-fixed (Linux io_uring builds).\n");
+    printf("  --device MODEL        Simulate slower storage under the database, journal and\n");
+    printf("                        WAL files (see below).\n");
+    printf("  --sync-us N           Simulated fsync latency, overriding the --device model's.\n");
+    printf("  --write-mbps N        Simulated write bandwidth in MB/s (0 = unlimited),\n");
+    printf("                        overriding the --device model's.\n");
+    printf("  --json PATH           Write one JSON record per test to PATH (\"-\" for stdout).\n");
+    printf("  --csv PATH            Write one CSV row per test to PATH (\"-\" for stdout).\n");
+    printf("                        With \"-\", the console output goes to stderr instead.\n");
+    printf("  --help                Show this message.\n\n");
+    printf("Tests (* = run by default):\n");
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        printf("  %c %-22s %s\n", _tests[i].default_on ? '*' : ' ', _tests[i].id, _tests[i].name);
+    }
+    printf("\nSchemas:\n");
+    for (size_t i = 0; i < NUM_SCHEMAS; ++i) {
+        printf("    %-22s %s\n", _schemas[i].id, _schemas[i].description);
+    }
+    printf("\nDevice models:\n");
+    models = bench_device_models(&num_models);
+    for (int i = 0; i < num_models; ++i) {
+        printf("    %-22s %s\n", models[i].id, models[i].description);
+    }
+}
+
+
+/*
+** Fill in the global configuration from the command line. Exits on any
+** unknown option or bad value.
+*/
+void parse_args(int argc, char **argv) {
+    const char *opt;
+    const char *val;
+
+    for (int i = 1; i < argc; ++i) {
+        opt = argv[i];
+
+        /*
+        ** Options without a value.
+        */
+        if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+            print_usage(argv[0]);
+            exit(0);
+        }
+        if (strcmp(opt, "--memory") == 0) {
+            _config.memory_mode = 1;
+            continue;
+        }
+        if (strcmp(opt, "--no-latency") == 0) {
+            _config.latency = 0;
+            continue;
+        }
+        if (strcmp(opt, "--latency-series") == 0) {
+            _config.latency_series = 1;
+            continue;
+        }
+        if (strcmp(opt, "--perf") == 0) {
+            _config.perf = 1;
+            continue;
+        }
+        if (strcmp(opt, "--io-stats") == 0) {
+            _config.io_stats = 1;
+            continue;
+        }
+
+        /*
+        ** Everything else takes exactly one value.
+        */
+        if (i + 1 >= argc) {
+            die_usage("Missing value for option %s", opt);
+        }
+        val = argv[++i];
+
+        if (strcmp(opt, "--rows") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid row count: %s", val);
+            }
+            _config.num_rows = atoi(val);
+        }
+        else if (strcmp(opt, "--db") == 0) {
+            _config.db_path = val;
+        }
+        else if (strcmp(opt, "--journal-mode") == 0) {
+            _config.journal_mode = val;
+        }
+        else if (strcmp(opt, "--synchronous") == 0) {
+            _config.synchronous = val;
+        }
+        else if (strcmp(opt, "--page-size") == 0) {
+            if (!is_integer(val)) {
+                die_usage("Invalid page size: %s", val);
+            }
+            _config.page_size = val;
+        }
+        else if (strcmp(opt, "--cache-size") == 0) {
+            if (!is_integer(val)) {
+                die_usage("Invalid cache size: %s", val);
+            }
+            _config.cache_size = val;
+        }
+        else if (strcmp(opt, "--mmap-size") == 0) {
+            if (!is_integer(val)) {
+                die_usage("Invalid mmap size: %s", val);
+            }
+            _config.mmap_size = val;
+        }
+        else if (strcmp(opt, "--tests") == 0) {
+            _config.tests = val;
+        }
+        else if (strcmp(opt, "--schema") == 0) {
+            _config.schemas = val;
+        }
+        else if (strcmp(opt, "--seed") == 0) {
+            if (!is_integer(val) || val[0] == '-') {
+                die_usage("Invalid seed: %s", val);
+            }
+            _config.seed = strtoull(val, NULL, 10);
+        }
+        else if (strcmp(opt, "--batch-rows") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid batch row count: %s", val);
+            }
+            _config.batch_rows = atoi(val);
+        }
+        else if (strcmp(opt, "--shards") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid shard count: %s", val);
+            }
+            _config.shards = atoi(val);
+        }
+        else if (strcmp(opt, "--readers") == 0) {
+            if (!is_integer(val) || atoi(val) < 0) {
+                die_usage("Invalid reader thread count: %s", val);
+            }
+            _config.readers = atoi(val);
+        }
+        else if (strcmp(opt, "--writers") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid writer thread count: %s", val);
+            }
+            _config.writers = atoi(val);
+        }
+        else if (strcmp(opt, "--producers") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid producer thread count: %s", val);
+            }
+            _config.producers = atoi(val);
+        }
+        else if (strcmp(opt, "--group-rows") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid group commit row count: %s", val);
+            }
+            _config.group_rows = atoi(val);
+        }
+        else if (strcmp(opt, "--group-delay-us") == 0) {
+            if (!is_integer(val) || atoi(val) < 0) {
+                die_usage("Invalid group commit delay: %s", val);
+            }
+            _config.group_delay_us = atoi(val);
+        }
+        else if (strcmp(opt, "--sorter-threads") == 0) {
+            if (!is_integer(val) || atoi(val) < 0) {
+                die_usage("Invalid sorter thread count: %s", val);
+            }
+            _config.sorter_threads = atoi(val);
+        }
+        else if (strcmp(opt, "--vfs") == 0) {
+            if (sqlite3_vfs_find(val) == NULL) {
+                die_usage("Unknown VFS: %s", val);
+            }
+            _config.vfs = val;
+        }
+        else if (strcmp(opt, "--device") == 0) {
+            if (bench_device_find(val) == NULL) {
+                die_usage("Unknown device model: %s", val);
+            }
+            _config.device = val;
+        }
+        else if (strcmp(opt, "--sync-us") == 0) {
+            if (!is_integer(val) || atoi(val) < 0) {
+                die_usage("Invalid sync latency: %s", val);
+            }
+            _config.sync_us = atoi(val);
+        }
+        else if (strcmp(opt, "--write-mbps") == 0) {
+            if (!is_integer(val) || atoi(val) < 0) {
+                die_usage("Invalid write bandwidth: %s", val);
+            }
+            _config.write_mbps = atoi(val);
+        }
+        else if (strcmp(opt, "--json") == 0) {
+            _config.json_path = val;
+        }
+        else if (strcmp(opt, "--csv") == 0) {
+            _config.csv_path = val;
+        }
+        else if (strcmp(opt, "--series-interval-ms") == 0) {
+            if (!is_integer(val) || atoi(val) <= 0) {
+                die_usage("Invalid series interval: %s", val);
+            }
+            _config.series_interval_ms = atoi(val);
+        }
+        else {
+            die_usage("Unknown option: %s", opt);
+        }
+    }
+
+    if (_config.device != NULL || _config.sync_us >= 0 || _config.write_mbps >= 0) {
+        const bench_device_t *model = _config.device != NULL ? bench_device_find(_config.device) : NULL;
+
+        if (model != NULL) {
+            _device = *model;
+        }
+        else {
+            _device.id = "custom";
+            _device.description = "custom device";
+        }
+        if (_config.sync_us >= 0) {
+            _device.sync_us = _config.sync_us;
+        }
+        if (_config.write_mbps >= 0) {
+            _device.write_mbps = _config.write_mbps;
+        }
+        _config.device = _device.id;
+        _config.sync_us = _device.sync_us;
+        _config.write_mbps = _device.write_mbps;
+    }
+
+    /*
+    ** Make sure every requested test exists so a typo in a long scripted
+    ** run is caught up front rather than silently skipped.
+    */
+    if (_config.tests != NULL && strcmp(_config.tests, "all") != 0) {
+        const char *p = _config.tests;
+        while (*p != '\0') {
+            size_t len = strcspn(p, ",");
+            size_t j;
+            for (j = 0; j < NUM_TESTS; ++j) {
+                if (strlen(_tests[j].id) == len && strncmp(_tests[j].id, p, len) == 0) {
+                    break;
+                }
+            }
+            if (j == NUM_TESTS) {
+                die_usage("Unknown test in list: %s", p);
+            }
+            p += len;
+            if (*p == ',') {
+                ++p;
+            }
+        }
+    }
+
+    /*
+    ** Same for the schemas.
+    */
+    if (strcmp(_config.schemas, "all") != 0) {
+        const char *p = _config.schemas;
+        while (*p != '\0') {
+            size_t len = strcspn(p, ",");
+            size_t j;
+            for (j = 0; j < NUM_SCHEMAS; ++j) {
+                if (strlen(_schemas[j].id) == len && strncmp(_schemas[j].id, p, len) == 0) {
+                    break;
+                }
+            }
+            if (j == NUM_SCHEMAS) {
+                die_usage("Unknown schema in list: %s", p);
+            }
+            p += len;
+            if (*p == ',') {
+                ++p;
+            }
+        }
+    }
+}
+
+
+/*
+** Returns non-zero if the text is an optionally signed decimal integer.
+*/
+int is_integer(const char *text) {
+    if (*text == '-' || *text == '+') {
+        ++text;
+    }
+    if (*text == '\0') {
+        return 0;
+    }
+    for (; *text != '\0'; ++text) {
+        if (*text < '0' || *text > '9') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+/*
+** Returns non-zero if the test should run given the --tests option.
+*/
+int test_selected(const test_case_t *test) {
+    if (_config.tests == NULL) {
+        return test->default_on;
+    }
+    if (strcmp(_config.tests, "all") == 0) {
+        return 1;
+    }
+    return list_contains(_config.tests, test->id);
+}
+
+
+/*
+** Returns non-zero if id is one of the entries of a comma separated list.
+*/
+int list_contains(const char *list, const char *id) {
+    const char *p = list;
+    size_t id_len = strlen(id);
+
+    while (*p != '\0') {
+        size_t len = strcspn(p, ",");
+        if (len == id_len && strncmp(id, p, len) == 0) {
+            return 1;
+        }
+        p += len;
+        if (*p == ',') {
+            ++p;
+        }
+    }
+    return 0;
+}
+
+
+/*
+** Open database file. Deletes any existing database file
+** to prevent file growth skewing test results.
+*/
+void open_database() {
+    const char *path;
+
+    if (_config.memory_mode) {
+        path = MEMORY_DB_FILE_PATH;
+    }
+    else {
+        path = _config.db_path;
+    }
+
+    _db = open_fresh_database(path);
+    _db_path = path;
+}
+
+
+/*
+** Open a new, empty database at path with all of the PRAGMAs from the command
+** line applied. Any existing file at path is deleted first. Used for the
+** global connection and for tests that spread data over several files.
+*/
+sqlite3 *open_fresh_database(const char *path) {
+    int rc;
+    sqlite3 *db;
+
+    if (strcmp(path, MEMORY_DB_FILE_PATH) != 0) {
+        remove_database_files(path);
+    }
+
+    rc = sqlite3_open(path, &db);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    /*
+    ** page_size has to be set before the first table is created, so all of the
+    ** PRAGMAs are applied as soon as the database is opened.
+    */
+    apply_pragma(db, "page_size", _config.page_size);
+    apply_pragma(db, "journal_mode", _config.journal_mode);
+    apply_pragma(db, "synchronous", _config.synchronous);
+    apply_pragma(db, "cache_size", _config.cache_size);
+    apply_pragma(db, "mmap_size", _config.mmap_size);
+    return db;
+}
+
+
+/*
+** Open another connection to the database opened by open_database(), with
+** the per-connection PRAGMAs applied. journal_mode and page_size belong to
+** the database file, so they are left as open_database() and the test setup
+** made them. Close with sqlite3_close().
+*/
+sqlite3 *open_connection() {
+    int rc;
+    sqlite3 *db;
+
+    rc = sqlite3_open(_db_path, &db);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    apply_pragma(db, "synchronous", _config.synchronous);
+    apply_pragma(db, "cache_size", _config.cache_size);
+    apply_pragma(db, "mmap_size", _config.mmap_size);
+    return db;
+}
+
+
+/*
+** Delete a database file along with any rollback journal or WAL files left
+** behind by an earlier run, so a stale WAL can't be replayed into a new file.
+*/
+void remove_database_files(const char *path) {
+    static const char *suffixes[] = { "", "-journal", "-wal", "-shm" };
+    char file[1024];
+
+    for (size_t i = 0; i < sizeof(suffixes) / sizeof(suffixes[0]); ++i) {
+        snprintf(file, sizeof(file), "%s%s", path, suffixes[i]);
+        remove(file);
+    }
+}
+
+
+/*
+** Execute "PRAGMA name = value;" if a value was given on the command line.
+*/
+void apply_pragma(sqlite3 *db, const char *name, const char *value) {
+    int rc;
+    char sql[200];
+
+    if (value == NULL) {
+        return;
+    }
+
+    snprintf(sql, sizeof(sql), "PRAGMA %s = %s;", name, value);
+    rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/* Close database file. This will error if there are still
+** statement handles open.
+*/
+void close_database() {
+    int rc;
+    rc = sqlite3_close(_db);
+    if (rc != SQLITE_OK) {
+        die_db_error(_db);
+    }
+}
+
+
+/*
+** Read back the PRAGMA values in effect on the open connection.
+*/
+void read_pragmas(bench_pragmas_t *pragmas) {
+    int rc;
+    sqlite3_stmt *stmt;
+
+    rc = sqlite3_prepare_v2(_db, "PRAGMA journal_mode;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    pragmas->journal_mode[0] = '\0';
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        snprintf(pragmas->journal_mode, sizeof(pragmas->journal_mode), "%s",
+            (const char *)sqlite3_column_text(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+
+    pragmas->synchronous = (int)query_int64("PRAGMA synchronous;");
+    pragmas->page_size = (int)query_int64("PRAGMA page_size;");
+    pragmas->cache_size = (int)query_int64("PRAGMA cache_size;");
+    pragmas->mmap_size = query_int64("PRAGMA mmap_size;");
+}
+
+
+/*
+** Run a query that returns a single integer. Returns 0 if there are no rows.
+*/
+int64_t query_int64(const char *sql) {
+    int rc;
+    int64_t value = 0;
+    sqlite3_stmt *stmt;
+
+    rc = sqlite3_prepare_v2(_db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+
+/*
+** Setup the database for testing inserts. This will remove any existing file
+** and recreate the test table. The database cannot be open when this runs
+** due to file deletion.
+*/
+void setup_test() {
+    build_dataset();
+    create_test_table(_db);
+}
+
+
+/*
+** Create the Test table in the current --schema layout. Every layout has the
+** key and num1 - num4 columns, so the same INSERTs work against all of them.
+*/
+void create_test_table(sqlite3 *db) {
+    int rc;
+
+    rc = sqlite3_exec(db, _schema->sql, NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/*
+** Create the Test table in the layout schema_id, whatever --schema says, for
+** the NEEDS_OWN_TABLE tests. The test's results are reported under that
+** layout.
+*/
+void create_schema_table(sqlite3 *db, const char *schema_id) {
+    int rc;
+
+    for (size_t s = 0; s < NUM_SCHEMAS; ++s) {
+        if (strcmp(_schemas[s].id, schema_id) == 0) {
+            rc = sqlite3_exec(db, _schemas[s].sql, NULL, NULL, NULL);
+            if (rc != SQLITE_OK) {
+                die_conn_error(db);
+            }
+            _config.schema = _schemas[s].id;
+            return;
+        }
+    }
+
+    printf("Unknown schema %s.\n", schema_id);
+    exit(-1);
+}
+
+
+/*
+** Generate the num1 - num4 columns for every row into _data. This used to be
+** four rand() calls per row inside the timed loops, which measured libc as
+** much as SQLite and gave different data on every platform. Reused by later
+** tests with the same row count.
+*/
+void build_dataset() {
+    bench_rand_t rand;
+    int64_t start_ns;
+
+    if (_data.num1 != NULL && _data.num_rows == _config.num_rows) {
+        return;
+    }
+    free_dataset();
+
+    _data.num1 = malloc(sizeof(double) * (size_t)_config.num_rows);
+    _data.num2 = malloc(sizeof(double) * (size_t)_config.num_rows);
+    _data.num3 = malloc(sizeof(double) * (size_t)_config.num_rows);
+    _data.num4 = malloc(sizeof(double) * (size_t)_config.num_rows);
+    if (_data.num1 == NULL || _data.num2 == NULL || _data.num3 == NULL || _data.num4 == NULL) {
+        printf("Out of memory allocating data for %d rows.\n", _config.num_rows);
+        exit(-1);
+    }
+
+    /*
+    ** Row order, so any prefix of the data is the same regardless of the
+    ** row count.
+    */
+    start_ns = bench_now_ns();
+    bench_rand_seed(&rand, _config.seed);
+    for (int i = 0; i < _config.num_rows; ++i) {
+        _data.num1[i] = bench_rand_double(&rand, RAND_DOUBLE_LIMIT);
+        _data.num2[i] = bench_rand_double(&rand, RAND_DOUBLE_LIMIT);
+        _data.num3[i] = bench_rand_double(&rand, RAND_DOUBLE_LIMIT);
+        _data.num4[i] = bench_rand_double(&rand, RAND_DOUBLE_LIMIT);
+    }
+    _data.build_sec = (bench_now_ns() - start_ns) / 1e9;
+    _data.num_rows = _config.num_rows;
+}
+
+
+/*
+** Release the dataset.
+*/
+void free_dataset() {
+    free(_data.num1);
+    free(_data.num2);
+    free(_data.num3);
+    free(_data.num4);
+    memset(&_data, 0, sizeof(_data));
+}
+
+
+/*
+** The pre-generated row data for tests outside of main.c.
+*/
+const bench_dataset_t *bench_dataset() {
+    return &_data;
+}
+
+
+/*
+** Setup the database for testing updates. Updates will need some dummy data,
+** so populate the table with test data from one of the "prior" test cases.
+*/
+void setup_update_test() {
+    setup_test();
+    insert_rows_xact_prepared();
+}
+
+
+/*
+** The exectuion of the given test function. Runs the test's setup function
+** first (untimed) and fills in the result.
+*/
+void time_test_execution(const test_case_t *test, test_result_t *result) {
+    bench_times_t start, end, elapsed;
+    bench_perf_t perf;
+    bench_perf_counts_t perf_counts;
+    static int perf_warned;
+    bench_io_stats_t io_start, io_end;
+    int64_t pages;
+#if defined SQLITE_BENCH_COUNTERS
+    int balance_quick, balance_nonroot;
+#endif
+#if defined SQLITE_BENCH_COUNTERS && defined SQLITE_BENCH_IO_URING
+    sqlite3_int64 uring_enters, uring_sqes;
+#endif
+
+    bench_hist_init(&result->latency, (int64_t)_config.series_interval_ms * 1000000);
+    result->num_metrics = 0;
+    result->rows = _config.num_rows;
+
+    open_database();
+
+    /*
+    ** Setup the test before each run to prevent file size from
+    ** skewing results. 
+    */
+    if (test->setup_fun != NULL) {
+        test->setup_fun();
+    }
+
+    _result = result;
+    if (_config.latency) {
+        _latency = &result->latency;
+    }
+
+#if defined SQLITE_BENCH_COUNTERS
+    balance_quick = sqlite3_bench_balance_quick;
+    balance_nonroot = sqlite3_bench_balance_nonroot;
+#endif
+#if defined SQLITE_BENCH_COUNTERS && defined SQLITE_BENCH_IO_URING
+    uring_enters = sqlite3_bench_uring_enters;
+    uring_sqes = sqlite3_bench_uring_sqes;
+#endif
+
+    /*
+    ** Opened after the setup so its threads aren't counted, and before the
+    ** test starts any of its own, which are.
+    */
+    if (_config.perf && bench_perf_open(&perf) == 0 && !perf_warned) {
+        printf("No performance counters available (not Linux, or perf_event_paranoid too high).\n");
+        perf_warned = 1;
+    }
+
+    reset_sqlite_status();
+    bench_vfs_sample(&io_start);
+    bench_times_sample(&start);
+    if (_config.perf) {
+        bench_perf_start(&perf);
+    }
+    test->fun();
+    if (_config.perf) {
+        bench_perf_stop(&perf, &perf_counts);
+    }
+    bench_times_sample(&end);
+    bench_vfs_sample(&io_end);
+
+    if (_config.io_stats) {
+        add_io_metrics(&io_start, &io_end, result->rows);
+    }
+    if (_config.perf) {
+        add_perf_metrics(&perf_counts, result->rows);
+        bench_perf_close(&perf);
+    }
+
+    /*
+    ** How much btree rebalancing the test caused and how big the file ended
+    ** up, so the same rows loaded in different orders can be compared.
+    */
+#if defined SQLITE_BENCH_COUNTERS
+    bench_add_metric("balance_quick", sqlite3_bench_balance_quick - balance_quick);
+    bench_add_metric("balance_nonroot", sqlite3_bench_balance_nonroot - balance_nonroot);
+#endif
+
+    /*
+    ** How many io_uring submissions the I/O took, and how many operations
+    ** each carried, when the test ran on an io_uring VFS.
+    */
+#if defined SQLITE_BENCH_COUNTERS && defined SQLITE_BENCH_IO_URING
+    if (sqlite3_bench_uring_enters != uring_enters) {
+        bench_add_metric("uring_enters", (double)(sqlite3_bench_uring_enters - uring_enters));
+        bench_add_metric("uring_sqes_per_enter",
+            (double)(sqlite3_bench_uring_sqes - uring_sqes) / (sqlite3_bench_uring_enters - uring_enters));
+    }
+#endif
+    add_sqlite_status_metrics(result->rows);
+    pages = query_int64("PRAGMA page_count;");
+    bench_add_metric("page_count", (double)pages);
+    bench_add_metric("db_size_mb", pages * query_int64("PRAGMA page_size;") / 1048576.0);
+
+    _latency = NULL;
+    _result = NULL;
+
+    read_pragmas(&result->pragmas);
+    close_database();
+
+    bench_times_diff(&start, &end, &elapsed);
+    result->ran = 1;
+    result->wall_sec = elapsed.wall_ns / 1e9;
+    result->user_sec = elapsed.user_ns / 1e9;
+    result->sys_sec = elapsed.sys_ns / 1e9;
+    result->io_wait_sec = elapsed.io_wait_ns < 0 ? -1.0 : elapsed.io_wait_ns / 1e9;
+    result->rows_per_sec = result->wall_sec > 0 ? result->rows / result->wall_sec : 0.0;
+}
+
+
+/*
+** Report the performance counters of a test per row, as "<counter>_per_row",
+** plus instructions per cycle. Counters that weren't available are left out.
+*/
+void add_perf_metrics(const bench_perf_counts_t *counts, int64_t rows) {
+    char name[40];
+    int64_t cycles = counts->value[BENCH_PERF_CYCLES];
+    int64_t instructions = counts->value[BENCH_PERF_INSTRUCTIONS];
+
+    if (rows <= 0) {
+        return;
+    }
+    for (int i = 0; i < BENCH_PERF_NUM_COUNTERS; ++i) {
+        if (counts->value[i] >= 0) {
+            snprintf(name, sizeof(name), "%s_per_row", bench_perf_name(i));
+            bench_add_metric(name, (double)counts->value[i] / rows);
+        }
+    }
+    if (cycles > 0 && instructions >= 0) {
+        bench_add_metric("ipc", (double)instructions / cycles);
+    }
+}
+
+
+/*
+** Report the file I/O of a test through the bench_io VFS: calls, MiB (reads
+** and writes) and milliseconds for each file type and method used, as
+** "<type>_<method>_calls" and so on, and the bytes read and written and
+** syncs of all files per row, which show the I/O amplification.
+*/
+void add_io_metrics(const bench_io_stats_t *start, const bench_io_stats_t *end, int64_t rows) {
+    bench_io_stats_t io;
+    char name[40];
+    int64_t read_bytes = 0;
+    int64_t write_bytes = 0;
+    int64_t syncs = 0;
+
+    bench_vfs_diff(start, end, &io);
+    for (int t = 0; t < BENCH_IO_NUM_FILE_TYPES; ++t) {
+        for (int o = 0; o < BENCH_IO_NUM_OPS; ++o) {
+            const bench_io_stat_t *stat = &io.stat[t][o];
+            const char *type_name = bench_io_file_type_name(t);
+            const char *op_name = bench_io_op_name(o);
+
+            if (stat->calls == 0) {
+                continue;
+            }
+            snprintf(name, sizeof(name), "%s_%s_calls", type_name, op_name);
+            bench_add_metric(name, (double)stat->calls);
+            if (o == BENCH_IO_READ || o == BENCH_IO_WRITE) {
+                snprintf(name, sizeof(name), "%s_%s_mb", type_name, op_name);
+                bench_add_metric(name, stat->bytes / 1048576.0);
+            }
+            snprintf(name, sizeof(name), "%s_%s_ms", type_name, op_name);
+            bench_add_metric(name, stat->ns / 1e6);
+        }
+        read_bytes += io.stat[t][BENCH_IO_READ].bytes;
+        write_bytes += io.stat[t][BENCH_IO_WRITE].bytes;
+        syncs += io.stat[t][BENCH_IO_SYNC].calls;
+    }
+
+    if (rows > 0) {
+        bench_add_metric("read_bytes_per_row", (double)read_bytes / rows);
+        bench_add_metric("write_bytes_per_row", (double)write_bytes / rows);
+        bench_add_metric("syncs_per_1k", syncs * 1000.0 / rows);
+    }
+}
+
+
+/*
+** Zero the main connection's cache and lookaside counters, and reset the
+** memory high-water marks to what is in use now, so that the test's own
+** share can be read afterwards.
+*/
+void reset_sqlite_status() {
+    int current, highwater;
+    sqlite3_int64 current64, highwater64;
+
+    for (size_t i = 0; i < NUM_DB_STATUS_COUNTERS; ++i) {
+        sqlite3_db_status(_db, _db_status_counters[i].op, &current, &highwater, 1);
+    }
+    sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &current64, &highwater64, 1);
+    sqlite3_status64(SQLITE_STATUS_MALLOC_COUNT, &current64, &highwater64, 1);
+}
+
+
+/*
+** Report what the test did to the main connection's page cache and
+** lookaside per 1,000 rows, plus the page cache size and SQLite's memory
+** use. Tests that work through connections of their own (the concurrent,
+** sharded and ingest tests) only show what happened on the main one. The
+** memory figures are for the whole process.
+*/
+void add_sqlite_status_metrics(int64_t rows) {
+    int current, highwater;
+    sqlite3_int64 current64, highwater64;
+
+    if (rows > 0) {
+        for (size_t i = 0; i < NUM_DB_STATUS_COUNTERS; ++i) {
+            sqlite3_db_status(_db, _db_status_counters[i].op, &current, &highwater, 0);
+            bench_add_metric(_db_status_counters[i].name,
+                (_db_status_counters[i].use_highwater ? highwater : current) * 1000.0 / rows);
+        }
+    }
+
+    sqlite3_db_status(_db, SQLITE_DBSTATUS_CACHE_USED, &current, &highwater, 0);
+    bench_add_metric("cache_used_mb", current / 1048576.0);
+    sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &current64, &highwater64, 0);
+    bench_add_metric("memory_used_mb", current64 / 1048576.0);
+    bench_add_metric("memory_highwater_mb", highwater64 / 1048576.0);
+    sqlite3_status64(SQLITE_STATUS_MALLOC_COUNT, &current64, &highwater64, 0);
+    bench_add_metric("malloc_count", (double)current64);
+    bench_add_metric("malloc_highwater", (double)highwater64);
+}
+
+
+/*
+** Start timing one statement. Pair with latency_end(). Cheap no-ops when
+** latency tracking is off or outside the timed section (e.g. setup).
+*/
+int64_t latency_begin() {
+    return _latency != NULL ? bench_now_ns() : 0;
+}
+
+
+/*
+** Record the statement started by latency_begin() in the current histogram.
+*/
+void latency_end(int64_t start_ns) {
+    if (_latency != NULL) {
+        bench_hist_record(_latency, start_ns, bench_now_ns());
+    }
+}
+
+
+/*
+** The running test's latency histogram, or NULL when latency tracking is off
+** or outside the timed section. Multi-threaded tests record into their own
+** histograms and merge them into this one when the threads are done.
+*/
+bench_hist_t *bench_latency() {
+    return _latency;
+}
+
+
+/*
+** Attach a test specific measurement to the running test's result. Ignored
+** outside the timed section. Past BENCH_MAX_METRICS the rest are dropped,
+** with a warning the first time it happens.
+*/
+void bench_add_metric(const char *name, double value) {
+    bench_metric_t *metric;
+    static int metrics_warned;
+
+    if (_result == NULL) {
+        return;
+    }
+    if (_result->num_metrics >= BENCH_MAX_METRICS) {
+        if (!metrics_warned) {
+            printf("More than %d metrics for one test, dropping %s and any after it "
+                "(raise BENCH_MAX_METRICS in bench.h).\n", BENCH_MAX_METRICS, name);
+            metrics_warned = 1;
+        }
+        return;
+    }
+
+    metric = &_result->metrics[_result->num_metrics++];
+    snprintf(metric->name, sizeof(metric->name), "%s", name);
+    metric->value = value;
+}
+
+
+/*
+** Set the number of rows the running test processed, for tests that handle
+** more (or fewer) rows than --rows. Rows/sec is based on this.
+*/
+void bench_set_rows(int64_t rows) {
+    if (_result != NULL) {
+        _result->rows = rows;
+    }
+}
+
+
+/*
+** The benchmark configuration.
+*/
+const bench_config_t *bench_config() {
+    return &_config;
+}
+
+
+/*
+** The global connection opened for the running test.
+*/
+sqlite3 *bench_db() {
+    return _db;
+}
+
+
+/*
+** Print one row of the results table. See print_result_header().
+*/
+void print_result(const char *test_name, const test_result_t *result) {
+    printf("%30s %12.3f %12.3f %12.3f ", test_name, result->wall_sec, result->user_sec, result->sys_sec);
+    if (result->io_wait_sec < 0) {
+        printf("%13s ", "n/a");
+    }
+    else {
+        printf("%13.3f ", result->io_wait_sec);
+    }
+    printf("%14.2f\n", result->rows_per_sec);
+}
+
+
+/*
+** Print statement latency percentiles, in microseconds, for the tests of a
+** group that have run. Also prints the series when --latency-series is set.
+*/
+void print_latency_table(const char *group) {
+    const bench_hist_t *hist;
+
+    if (!_config.latency) {
+        return;
+    }
+
+    printf("\n");
+    printf("%-30s %-12s %-10s %-10s %-10s %-10s %-10s\n", "Statement latency (usec)", "Count", "Mean", "p50", "p99", "p99.9", "Max");
+    printf("%.30s %.12s %.10s %.10s %.10s %.10s %.10s\n", DASHES, DASHES, DASHES, DASHES, DASHES, DASHES, DASHES);
+
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        if (!_results[i].ran || strcmp(_tests[i].group, group) != 0) {
+            continue;
+        }
+        hist = &_results[i].latency;
+        printf("%30s %12llu %10.2f %10.2f %10.2f %10.2f %10.2f\n", _tests[i].name,
+            (unsigned long long)hist->count,
+            bench_hist_mean(hist) / 1e3,
+            bench_hist_percentile(hist, 50.0) / 1e3,
+            bench_hist_percentile(hist, 99.0) / 1e3,
+            bench_hist_percentile(hist, 99.9) / 1e3,
+            hist->max_ns / 1e3);
+    }
+
+    if (_config.latency_series) {
+        for (size_t i = 0; i < NUM_TESTS; ++i) {
+            if (_results[i].ran && strcmp(_tests[i].group, group) == 0) {
+                print_latency_series(_tests[i].name, &_results[i].latency);
+            }
+        }
+    }
+}
+
+
+/*
+** Print the latency-over-time series of one test. Each line covers one
+** --series-interval-ms interval from the first timed statement.
+*/
+void print_latency_series(const char *test_name, const bench_hist_t *hist) {
+    const bench_series_point_t *point;
+
+    printf("\n%s - latency over time\n", test_name);
+    printf("%-12s %-12s %-12s %-12s\n", "Time (ms)", "Count", "Mean (usec)", "Max (usec)");
+    printf("%.12s %.12s %.12s %.12s\n", DASHES, DASHES, DASHES, DASHES);
+
+    for (size_t i = 0; i < hist->series_len; ++i) {
+        point = &hist->series[i];
+        printf("%12lld %12llu %12.2f %12.2f\n",
+            (long long)(i * hist->series_interval_ns / 1000000),
+            (unsigned long long)point->count,
+            point->count ? point->sum_ns / 1e3 / point->count : 0.0,
+            point->max_ns / 1e3);
+    }
+}
+
+
+/*
+** Print the test specific metrics of every test in a group that has any.
+*/
+void print_metrics(const char *group) {
+    const test_result_t *result;
+
+    for (size_t i = 0; i < NUM_TESTS; ++i) {
+        result = &_results[i];
+        if (!result->ran || result->num_metrics == 0 || strcmp(_tests[i].group, group) != 0) {
+            continue;
+        }
+
+        printf("\n%s - details\n", _tests[i].name);
+        for (int m = 0; m < result->num_metrics; ++m) {
+            printf("  %-36s %16.3f\n", result->metrics[m].name, result->metrics[m].value);
+        }
+    }
+}
+
+
+/*
+** Print the column headings for print_result().
+*/
+void print_result_header() {
+    printf("%-30s %-12s %-12s %-12s %-13s %-14s\n", "Test", "Wall (sec)", "User (sec)", "Sys (sec)", "IO wait (sec)", "Rows/sec");
+    printf("%.30s %.12s %.12s %.12s %.13s %.14s\n", DASHES, DASHES, DASHES, DASHES, DASHES, DASHES);
+}
+
+
+/* 
+** Insert rows using a sprinted SQL statement without a transaction. This 
+** is gonna be slow.
+*/
+void insert_rows() {
+    int rc;
+    int64_t op_start;
+    char sql[500];
+    char key[25];
+    double num1, num2, num3, num4;
+
+    for (int i = 0; i < _config.num_rows; ++i) {
+        /*
+        ** Generate dummy data.
+        */
+        sprintf(key, "%d", i);
+        num1 = _data.num1[i];
+        num2 = _data.num2[i];
+        num3 = _data.num3[i];
+        num4 = _data.num4[i];
+
+        /*
+        ** Build SQL for each insert. Note: This is not very safe because single quotes in "key"
+        ** could break the statement. Also open for SQL injection and slow due to many sprintfs.
+        */
+        sprintf(sql, "INSERT INTO Test(key, num1, num2, num3, num4) VALUES('%s', %f, %f, %f, %f);",
+            key, num1, num2, num3, num4);
+
+        op_start = latency_begin();
+        rc = sqlite3_exec(_db, sql, NULL, NULL, NULL);
+        latency_end(op_start);
+        if (rc != SQLITE_OK) {
+            die_db_error();
+        }
+    }
+
+}
+
+
+/*
+** Same setup as inserting, but now wrapped in a transaction. 
+*/
+void insert_rows_xact() {
+    int rc;
+    int64_t op_start;
+    char sql[500];
+    char key[25];
+    double num1, num2, num3, num4;
+
+    /*
+    ** Start the transaction. Changes will be kept in a journal file (or memory)
+    ** until the transaction is committed. Will be much faster in bulk processing.
+    */
+    rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    for (int i = 0; i < _config.num_rows; ++i) {
+        sprintf(key, "K-%d", i);
+        num1 = _data.num1[i];
+        num2 = _data.num2[i];
+        num3 = _data.num3[i];
+        num4 = _data.num4[i];
+
+        sprintf(sql, "INSERT INTO Test(key, num1, num2, num3, num4) VALUES('%s', %f, %f, %f, %f);",
+            key, num1, num2, num3, num4);
+
+        op_start = latency_begin();
+        rc = sqlite3_exec(_db, sql, NULL, NULL, NULL);
+        latency_end(op_start);
+        if (rc != SQLITE_OK) {
+            die_db_error();
+        }
+    }
+
+    /*
+    ** Commit the transaction, writing changes from the journal into the database.
+    */
+    op_start = latency_begin();
+    rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+}
+
+
+/*
+** Uses a prepared statement ot insert data instead of building a SQL string
+** in each loop. Also uses a transaction. 
+*/
+void insert_rows_xact_prepared() {
+    insert_rows_xact_prepared_ex(1);
+}
+
+
+/*
+** insert_rows_xact_prepared without the sqlite3_clear_bindings per row.
+*/
+void insert_rows_xact_prepared_lean() {
+    insert_rows_xact_prepared_ex(0);
+}
+
+
+/*
+** The prepared insert loop. clear_bindings selects whether
+** sqlite3_clear_bindings is called along with sqlite3_reset for every row.
+*/
+void insert_rows_xact_prepared_ex(int clear_bindings) {
+    int rc;
+    int64_t op_start;
+    const char *sql;
+    char key[25];
+    double num1, num2, num3, num4;
+    sqlite3_stmt *stmt;
+
+    rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    /*
+    ** Build statement once. "?" mark parameters. Also can use other types of parameter
+    ** placeholders that will make things easier: https://sqlite.org/c3ref/bind_blob.html
+    */
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(_db, sql, -1, 0, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    for (int i = 0; i < _config.num_rows; ++i) {
+        sprintf(key, "K-%d", i);
+        num1 = _data.num1[i];
+        num2 = _data.num2[i];
+        num3 = _data.num3[i];
+        num4 = _data.num4[i];
+
+        /*
+        ** Bind parameters. The parameter index starts at 1.
+        */
+        sqlite3_bind_text(stmt, 1, key, -1, NULL);
+        sqlite3_bind_double(stmt, 2, num1);
+        sqlite3_bind_double(stmt, 3, num2);
+        sqlite3_bind_double(stmt, 4, num3);
+        sqlite3_bind_double(stmt, 5, num4);
+
+        op_start = latency_begin();
+        rc = sqlite3_step(stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_DONE) {
+            die_db_error();
+        }
+
+        /*
+        ** Reset the statement for next execution. Must be done
+        ** to reuse prepared statement. Clearing the bindings isn't needed
+        ** since every parameter is bound again for the next row; the lean
+        ** variant skips it.
+        */
+        if (clear_bindings) {
+            sqlite3_clear_bindings(stmt);
+        }
+        sqlite3_reset(stmt);
+    }
+
+
+    op_start = latency_begin();
+    rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    /*
+    ** Must call finalize to cleanup stuff. If this isn't called, then
+    ** sqlite3_close(*db) will blow up.
+    */
+    sqlite3_finalize(stmt);
+}
+
+
+/*
+** Same as insert_rows_xact_prepared, but each INSERT has a VALUES list of
+** --batch-rows rows: "VALUES(?, ?, ?, ?, ?), (?, ?, ?, ?, ?), ...". That
+** spreads the sqlite3_step/sqlite3_reset and VDBE program start up cost over
+** many rows. A second statement is prepared for the leftover rows when the row
+** count isn't a multiple of the batch size.
+*/
+void insert_rows_xact_multirow() {
+    int rc;
+    int64_t op_start;
+    int batch_rows;
+    int max_rows;
+    int tail_rows;
+    int param;
+    int64_t statements = 0;
+    char (*keys)[25];
+    sqlite3_stmt *stmt;
+    sqlite3_stmt *tail_stmt = NULL;
+    sqlite3_stmt *cur;
+
+    /*
+    ** Each row uses 5 parameters, and a statement can only have
+    ** SQLITE_MAX_VARIABLE_NUMBER (999 by default) of them.
+    */
+    batch_rows = _config.batch_rows;
+    max_rows = sqlite3_limit(_db, SQLITE_LIMIT_VARIABLE_NUMBER, -1) / 5;
+    if (batch_rows > max_rows) {
+        batch_rows = max_rows;
+    }
+    if (batch_rows > _config.num_rows) {
+        batch_rows = _config.num_rows;
+    }
+    tail_rows = _config.num_rows % batch_rows;
+
+    keys = malloc(sizeof(*keys) * batch_rows);
+    if (keys == NULL) {
+        printf("Out of memory allocating %d keys.\n", batch_rows);
+        exit(-1);
+    }
+
+    rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    stmt = prepare_multirow_insert(batch_rows);
+    if (tail_rows > 0) {
+        tail_stmt = prepare_multirow_insert(tail_rows);
+    }
+
+    for (int i = 0; i < _config.num_rows; i += batch_rows) {
+        int rows = _config.num_rows - i < batch_rows ? _config.num_rows - i : batch_rows;
+        cur = rows == batch_rows ? stmt : tail_stmt;
+
+        /*
+        ** Bind a whole block of rows. The keys stay in "keys" until after the
+        ** step, so they can be bound without SQLite making a copy.
+        */
+        param = 1;
+        for (int r = 0; r < rows; ++r) {
+            sprintf(keys[r], "K-%d", i + r);
+            sqlite3_bind_text(cur, param++, keys[r], -1, SQLITE_STATIC);
+            sqlite3_bind_double(cur, param++, _data.num1[i + r]);
+            sqlite3_bind_double(cur, param++, _data.num2[i + r]);
+            sqlite3_bind_double(cur, param++, _data.num3[i + r]);
+            sqlite3_bind_double(cur, param++, _data.num4[i + r]);
+        }
+
+        op_start = latency_begin();
+        rc = sqlite3_step(cur);
+        latency_end(op_start);
+        if (rc != SQLITE_DONE) {
+            die_db_error();
+        }
+
+        sqlite3_reset(cur);
+        ++statements;
+    }
+
+    op_start = latency_begin();
+    rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(tail_stmt);
+    free(keys);
+
+    bench_add_metric("batch_rows", batch_rows);
+    bench_add_metric("statements", (double)statements);
+}
+
+
+/*
+** Prepare "INSERT INTO Test(...) VALUES(?, ?, ?, ?, ?), ..." with the given
+** number of rows in the VALUES list.
+*/
+sqlite3_stmt *prepare_multirow_insert(int rows) {
+    static const char head[] = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES";
+    static const char row[] = "(?, ?, ?, ?, ?)";
+    int rc;
+    char *sql;
+    char *p;
+    sqlite3_stmt *stmt;
+
+    sql = malloc(sizeof(head) + (size_t)rows * (sizeof(row) + 1) + 1);
+    if (sql == NULL) {
+        printf("Out of memory building a %d row INSERT.\n", rows);
+        exit(-1);
+    }
+
+    p = sql;
+    memcpy(p, head, sizeof(head) - 1);
+    p += sizeof(head) - 1;
+    for (int r = 0; r < rows; ++r) {
+        if (r > 0) {
+            *p++ = ',';
+        }
+        memcpy(p, row, sizeof(row) - 1);
+        p += sizeof(row) - 1;
+    }
+    *p++ = ';';
+    *p = '\0';
+
+    rc = sqlite3_prepare_v3(_db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    free(sql);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    return stmt;
+}
+
+
+/*
+** Setup for the key arena tests: the usual table, plus the keys formatted
+** ahead of time so sprintf isn't part of the timed loop.
+*/
+void setup_key_arena_test() {
+    setup_test();
+    build_key_arena();
 }
 
 
 /*
-** Print a message and exit if there is a critical database error. 
+** setup_key_arena_test plus the int offsets for insert_rows_arena_batch.
 */
-void die_db_error() {
-    const char *msg;
-    msg = sqlite3_errmsg(_db);
-    printf("SQLite Error - %s\n", msg);
-    printf("PRESS ANY KEY TO EXIT.\n");
-    getchar();
-    exit(-1);
+void setup_key_arena_batch_test() {
+    setup_key_arena_test();
+    build_key_batch_offsets();
 }
 
 
 /*
-** Open database file. Deletes any existing database file
-** to prevent file growth skewing test results.
+** setup_key_arena_test plus the key order for insert_rows_arena_sorted.
 */
-void open_database() {
-    int rc;
+void setup_sorted_test() {
+    setup_key_arena_test();
+    sort_key_arena();
+}
 
-#if !defined MEMORY_MODE
-    remove(DB_FILE_PATH);
-#endif
 
-    rc = sqlite3_open(DB_FILE_PATH, &_db);
-    if (rc != SQLITE_OK) {
-        die_db_error(_db);
-    }
+/*
+** The Test table as a WITHOUT ROWID table: the rows are stored in the
+** primary key's btree, so there is no separate rowid table and
+** sqlite_autoindex to keep in step. Used whatever --schema says.
+*/
+void setup_without_rowid_test() {
+    build_dataset();
+    create_schema_table(_db, "without_rowid");
+    build_key_arena();
 }
 
 
-/* Close database file. This will error if there are still
-** statement handles open.
+/*
+** setup_without_rowid_test plus the key order.
 */
-void close_database() {
-    int rc;
-    rc = sqlite3_close(_db);
-    if (rc != SQLITE_OK) {
-        die_db_error(_db);
-    }
+void setup_without_rowid_sorted_test() {
+    setup_without_rowid_test();
+    sort_key_arena();
 }
 
 
 /*
-** Setup the database for testing inserts. This will remove any existing file
-** and recreate the test table. The database cannot be open when this runs
-** due to file deletion.
+** Format all of the keys into _keys. Reused by later tests with the same row
+** count. The time it takes is reported as the key formatting cost.
 */
-void setup_test() {
-    int rc;
-    const char *sql;
+void build_key_arena() {
+    int64_t start_ns;
+    size_t capacity;
+    size_t used = 0;
+    int len;
+
+    if (_keys.bytes != NULL && _keys.num_keys == _config.num_rows) {
+        return;
+    }
+    free_key_arena();
 
-    sql = "CREATE TABLE IF NOT EXISTS Test("
-           "key TEXT, "
-           "num1 FLOAT, "
-           "num2 FLOAT, "
-           "num3 FLOAT, "
-           "num4 FLOAT, "
-           "PRIMARY KEY(key) );";
+    /*
+    ** "K-" plus at most 10 digits for an int.
+    */
+    capacity = (size_t)_config.num_rows * 12;
+    _keys.bytes = malloc(capacity + 1);
+    _keys.offsets = malloc(sizeof(size_t) * ((size_t)_config.num_rows + 1));
+    if (_keys.bytes == NULL || _keys.offsets == NULL) {
+        printf("Out of memory allocating keys for %d rows.\n", _config.num_rows);
+        exit(-1);
+    }
 
-    rc = sqlite3_exec(_db, sql, NULL, NULL, NULL);
-    if (rc != SQLITE_OK) {
-        die_db_error(_db);
+    start_ns = bench_now_ns();
+    for (int i = 0; i < _config.num_rows; ++i) {
+        _keys.offsets[i] = used;
+        len = sprintf(_keys.bytes + used, "K-%d", i);
+        used += len;
     }
+    _keys.offsets[_config.num_rows] = used;
+    _keys.build_sec = (bench_now_ns() - start_ns) / 1e9;
+    _keys.num_keys = _config.num_rows;
 }
 
 
 /*
-** Setup the database for testing updates. Updates will need some dummy data,
-** so populate the table with test data from one of the "prior" test cases.
+** Sort the arena's row numbers into the order SQLite keeps the keys in
+** (BINARY collation: memcmp, then the shorter key first).
 */
-void setup_update_test() {
-    setup_test();
-    insert_rows_xact_prepared();
+void sort_key_arena() {
+    int64_t start_ns;
+
+    if (_keys.sorted != NULL) {
+        return;
+    }
+
+    _keys.sorted = malloc(sizeof(int) * (size_t)_keys.num_keys);
+    if (_keys.sorted == NULL) {
+        printf("Out of memory sorting keys for %d rows.\n", _keys.num_keys);
+        exit(-1);
+    }
+
+    start_ns = bench_now_ns();
+    for (int i = 0; i < _keys.num_keys; ++i) {
+        _keys.sorted[i] = i;
+    }
+    qsort(_keys.sorted, (size_t)_keys.num_keys, sizeof(int), compare_arena_keys);
+    _keys.sort_sec = (bench_now_ns() - start_ns) / 1e9;
 }
 
 
 /*
-** The exectuion of the given test function. Takes a function to test and a 
-** function to use to prepare the tests.
+** Copy the arena's offsets into batch_offsets for sqlite3_exec_batch(),
+** whose offsets are ints. Exits if the keys don't fit in INT_MAX bytes.
 */
-void time_test_execution(const char *test_name, void(*fun)(), void(*setup_fun)()) {
-    time_t start, end;
-    double time_ms;
-
-    open_database();
+void build_key_batch_offsets() {
+    if (_keys.batch_offsets != NULL) {
+        return;
+    }
 
-    /*
-    ** Setup the test before each run to prevent file size from
-    ** skewing results. 
-    */
-    if (setup_fun != NULL) {
-        setup_fun();
+    if (_keys.offsets[_keys.num_keys] > INT_MAX) {
+        printf("The keys for %d rows take %llu bytes, more than sqlite3_exec_batch() can address.\n",
+            _keys.num_keys, (unsigned long long)_keys.offsets[_keys.num_keys]);
+        exit(-1);
     }
 
-#if defined PRAGMA_JOURNAL_MEM
-    sqlite3_exec(_db, "PRAGMA journal_mode = MEMORY;", NULL, NULL, NULL);
-#endif
+    _keys.batch_offsets = malloc(sizeof(int) * ((size_t)_keys.num_keys + 1));
+    if (_keys.batch_offsets == NULL) {
+        printf("Out of memory allocating key offsets for %d rows.\n", _keys.num_keys);
+        exit(-1);
+    }
 
-    start = clock();
-    fun();
-    end = clock();
+    for (int i = 0; i <= _keys.num_keys; ++i) {
+        _keys.batch_offsets[i] = (int)_keys.offsets[i];
+    }
+}
 
-    close_database();
 
-    time_ms = (end - start) / (double)CLOCKS_PER_SEC;
-    printf("%30s %12.2f %12.2f\n", test_name, time_ms, NUM_EXECUTIONS / time_ms );
+/*
+** qsort() comparison of two row numbers by their keys in the arena.
+*/
+int compare_arena_keys(const void *a, const void *b) {
+    int i = *(const int *)a;
+    int j = *(const int *)b;
+    size_t len_i = _keys.offsets[i + 1] - _keys.offsets[i];
+    size_t len_j = _keys.offsets[j + 1] - _keys.offsets[j];
+    int c;
+
+    c = memcmp(_keys.bytes + _keys.offsets[i], _keys.bytes + _keys.offsets[j], len_i < len_j ? len_i : len_j);
+    if (c != 0) {
+        return c;
+    }
+    return len_i < len_j ? -1 : len_i > len_j;
 }
 
 
 /*
-** Simple random generator for doubles. 
+** Release the key arena.
 */
-inline double rand_double() {
-    return (double)rand() / (RAND_MAX / RAND_DOUBLE_LIMIT);
+void free_key_arena() {
+    free(_keys.bytes);
+    free(_keys.offsets);
+    free(_keys.batch_offsets);
+    free(_keys.sorted);
+    memset(&_keys, 0, sizeof(_keys));
 }
 
 
-/* 
-** Insert rows using a sprinted SQL statement without a transaction. This 
-** is gonna be slow.
+/*
+** insert_rows_xact_prepared with pre-formatted keys bound with their length
+** and SQLITE_STATIC. insert_rows_xact_prepared binds its key with
+** SQLITE_STATIC too, so the difference is the sprintf and strlen per row.
 */
-void insert_rows() {
-    int rc;
-    char sql[500];
-    char key[25];
-    double num1, num2, num3, num4;
+void insert_rows_arena_static() {
+    insert_rows_arena(SQLITE_STATIC, NULL);
+}
 
-    for (int i = 0; i < NUM_EXECUTIONS; ++i) {
-        /*
-        ** Generate dummy data.
-        */
-        sprintf(key, "%d", i);
-        num1 = rand_double();
-        num2 = rand_double();
-        num3 = rand_double();
-        num4 = rand_double();
 
-        /*
-        ** Build SQL for each insert. Note: This is not very safe because single quotes in "key"
-        ** could break the statement. Also open for SQL injection and slow due to many sprintfs.
-        */
-        sprintf(sql, "INSERT INTO Test(key, num1, num2, num3, num4) VALUES('%s', %f, %f, %f, %f);",
-            key, num1, num2, num3, num4);
+/*
+** Same as insert_rows_arena_static, but SQLITE_TRANSIENT makes SQLite copy
+** each key. The difference between the two is the cost of that copy.
+*/
+void insert_rows_arena_transient() {
+    insert_rows_arena(SQLITE_TRANSIENT, NULL);
+}
 
-        rc = sqlite3_exec(_db, sql, NULL, NULL, NULL);
-        if (rc != SQLITE_OK) {
-            die_db_error();
-        }
-    }
 
+/*
+** insert_rows_arena_static in key order. "K-%d" keys counted up in decimal
+** are not in key order ("K-10" < "K-2"), so the natural order lands each
+** insert somewhere in the middle of the primary key index. In key order
+** every insert goes to the right-most leaf, so the pages being written stay
+** in cache and far fewer of them need balance_nonroot(). (balance_quick()
+** is only used for rowid tables, so it doesn't help the index itself.)
+*/
+void insert_rows_arena_sorted() {
+    insert_rows_arena(SQLITE_STATIC, _keys.sorted);
 }
 
 
 /*
-** Same setup as inserting, but now wrapped in a transaction. 
+** Prepared insert in a transaction, binding keys straight out of the arena.
+** Comparing against "Insert Rows (xact, prep)" splits the per row cost into
+** key formatting/copying and the btree work that's left. Rows go in the
+** order given by order, or by row number if it is NULL.
 */
-void insert_rows_xact() {
+void insert_rows_arena(sqlite3_destructor_type key_destructor, const int *order) {
     int rc;
-    char sql[500];
-    char key[25];
-    double num1, num2, num3, num4;
+    int row;
+    int64_t op_start;
+    const char *sql;
+    sqlite3_stmt *stmt;
 
-    /*
-    ** Start the transaction. Changes will be kept in a journal file (or memory)
-    ** until the transaction is committed. Will be much faster in bulk processing.
-    */
     rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
 
-    for (int i = 0; i < NUM_EXECUTIONS; ++i) {
-        sprintf(key, "K-%d", i);
-        num1 = rand_double();
-        num2 = rand_double();
-        num3 = rand_double();
-        num4 = rand_double();
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(_db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
 
-        sprintf(sql, "INSERT INTO Test(key, num1, num2, num3, num4) VALUES('%s', %f, %f, %f, %f);",
-            key, num1, num2, num3, num4);
+    for (int i = 0; i < _config.num_rows; ++i) {
+        row = order != NULL ? order[i] : i;
+        sqlite3_bind_text(stmt, 1, _keys.bytes + _keys.offsets[row],
+            (int)(_keys.offsets[row + 1] - _keys.offsets[row]), key_destructor);
+        sqlite3_bind_double(stmt, 2, _data.num1[row]);
+        sqlite3_bind_double(stmt, 3, _data.num2[row]);
+        sqlite3_bind_double(stmt, 4, _data.num3[row]);
+        sqlite3_bind_double(stmt, 5, _data.num4[row]);
 
-        rc = sqlite3_exec(_db, sql, NULL, NULL, NULL);
-        if (rc != SQLITE_OK) {
+        op_start = latency_begin();
+        rc = sqlite3_step(stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_DONE) {
             die_db_error();
         }
+
+        sqlite3_reset(stmt);
     }
 
-    /*
-    ** Commit the transaction, writing changes from the journal into the database.
-    */
+    op_start = latency_begin();
     rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
+
+    sqlite3_finalize(stmt);
+
+    bench_add_metric("key_format_sec", _keys.build_sec);
+    bench_add_metric("key_format_ns_per_row", _keys.build_sec * 1e9 / _config.num_rows);
+    if (order != NULL) {
+        bench_add_metric("key_sort_sec", _keys.sort_sec);
+    }
 }
 
 
 /*
-** Uses a prepared statement ot insert data instead of building a SQL string
-** in each loop. Also uses a transaction. 
+** insert_rows_arena_static with the whole bind / step / reset loop done by
+** one sqlite3_exec_batch() call (a benchmark addition to sqlite3.c) on the
+** key arena and the dataset's num1 - num4 arrays, so the only time per row
+** is what SQLite spends inside. The latency histogram holds that one call
+** and the COMMIT.
 */
-void insert_rows_xact_prepared() {
+void insert_rows_arena_batch() {
+    sqlite3_batch_column columns[5];
     int rc;
+    int done;
+    int64_t op_start;
     const char *sql;
-    char key[25];
-    double num1, num2, num3, num4;
     sqlite3_stmt *stmt;
 
+    memset(columns, 0, sizeof(columns));
+    columns[0].eType = SQLITE_TEXT;
+    columns[0].aData = _keys.bytes;
+    columns[0].aOffset = _keys.batch_offsets;
+    columns[1].aData = _data.num1;
+    columns[2].aData = _data.num2;
+    columns[3].aData = _data.num3;
+    columns[4].aData = _data.num4;
+    for (int c = 1; c < 5; ++c) {
+        columns[c].eType = SQLITE_FLOAT;
+    }
+
     rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
 
-    /*
-    ** Build statement once. "?" mark parameters. Also can use other types of parameter
-    ** placeholders that will make things easier: https://sqlite.org/c3ref/bind_blob.html
-    */
     sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
-    rc = sqlite3_prepare_v3(_db, sql, -1, 0, &stmt, NULL);
+    rc = sqlite3_prepare_v3(_db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
 
-    for (int i = 0; i < NUM_EXECUTIONS; ++i) {
-        sprintf(key, "K-%d", i);
-        num1 = rand_double();
-        num2 = rand_double();
-        num3 = rand_double();
-        num4 = rand_double();
-
-        /*
-        ** Bind parameters. The parameter index starts at 1.
-        */
-        sqlite3_bind_text(stmt, 1, key, -1, NULL);
-        sqlite3_bind_double(stmt, 2, num1);
-        sqlite3_bind_double(stmt, 3, num2);
-        sqlite3_bind_double(stmt, 4, num3);
-        sqlite3_bind_double(stmt, 5, num4);
-
-        rc = sqlite3_step(stmt);
-        if (rc != SQLITE_DONE) {
-            die_db_error();
-        }
-
-        /*
-        ** Reset the statement for next execution. Must be done
-        ** to reuse prepared statement.
-        */
-        sqlite3_clear_bindings(stmt);
-        sqlite3_reset(stmt);
+    op_start = latency_begin();
+    rc = sqlite3_exec_batch(stmt, 5, columns, _config.num_rows, &done);
+    latency_end(op_start);
+    if (rc != SQLITE_OK) {
+        printf("sqlite3_exec_batch() stopped after %d of %d rows.\n", done, _config.num_rows);
+        die_db_error();
     }
 
-
+    op_start = latency_begin();
     rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
 
-    /*
-    ** Must call finalize to cleanup stuff. If this isn't called, then
-    ** sqlite3_close(*db) will blow up.
-    */
     sqlite3_finalize(stmt);
+
+    bench_add_metric("key_format_sec", _keys.build_sec);
 }
 
 
@@ -375,8 +2225,26 @@ void insert_rows_xact_prepared() {
 ** test using a primary key in the update statement.
 */
 void update_rows_pk() {
+    update_rows_pk_ex(1);
+}
+
+
+/*
+** update_rows_pk without the sqlite3_clear_bindings per row.
+*/
+void update_rows_pk_lean() {
+    update_rows_pk_ex(0);
+}
+
+
+/*
+** The update by primary key loop. See insert_rows_xact_prepared_ex for
+** clear_bindings.
+*/
+void update_rows_pk_ex(int clear_bindings) {
     int rc;
     int up_rc;
+    int64_t op_start;
     const char *sql;
     const char *tmp_key;
     test_t row;
@@ -389,7 +2257,18 @@ void update_rows_pk() {
         die_db_error();
     }
 
-    sql = "SELECT key, num1, num2, num3, num4 FROM Test ORDER BY key;";
+    /*
+    ** Without a rowid, an UPDATE deletes and re-inserts the row in the same
+    ** btree the SELECT is walking, and the SELECT ends up on that row again,
+    ** forever. "+key" keeps the order but makes SQLite sort the rows up front
+    ** instead of walking the table.
+    */
+    if (_schema->provides & NEEDS_ROWID) {
+        sql = "SELECT key, num1, num2, num3, num4 FROM Test ORDER BY key;";
+    }
+    else {
+        sql = "SELECT key, num1, num2, num3, num4 FROM Test ORDER BY +key;";
+    }
     rc = sqlite3_prepare_v3(_db, sql, -1, 0, &sel_stmt, NULL);
     if (rc != SQLITE_OK) {
         die_db_error();
@@ -403,9 +2282,17 @@ void update_rows_pk() {
 
     /*
     ** Loop through the rows in the select statement, and update the values using
-    ** the primary key.
+    ** the primary key. Both statements' steps are timed, as the select does
+    ** the reads.
     */
-    while ((rc = sqlite3_step(sel_stmt)) == SQLITE_ROW) {
+    for (;;) {
+        op_start = latency_begin();
+        rc = sqlite3_step(sel_stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_ROW) {
+            break;
+        }
+
         /*
         ** Get data from select statement handle. Using a strcpy to get the key
         ** because SQLite will malloc this stuff, so this is probably closer to 
@@ -440,7 +2327,9 @@ void update_rows_pk() {
         */
         sqlite3_bind_text(up_stmt, 5, row.key, -1, SQLITE_STATIC);
 
+        op_start = latency_begin();
         up_rc = sqlite3_step(up_stmt);
+        latency_end(op_start);
         if (up_rc != SQLITE_DONE) {
             die_db_error();
         }
@@ -449,10 +2338,14 @@ void update_rows_pk() {
         ** Reset update statement for next row.
         */
         sqlite3_reset(up_stmt);
-        sqlite3_clear_bindings(up_stmt);
+        if (clear_bindings) {
+            sqlite3_clear_bindings(up_stmt);
+        }
     }
 
+    op_start = latency_begin();
     rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
@@ -471,8 +2364,26 @@ void update_rows_pk() {
 ** the primary key: https://www.sqlite.org/lang_createtable.html#rowid
 */
 void update_rows_rowid() {
+    update_rows_rowid_ex(1);
+}
+
+
+/*
+** update_rows_rowid without the sqlite3_clear_bindings per row.
+*/
+void update_rows_rowid_lean() {
+    update_rows_rowid_ex(0);
+}
+
+
+/*
+** The update by rowid loop. See insert_rows_xact_prepared_ex for
+** clear_bindings.
+*/
+void update_rows_rowid_ex(int clear_bindings) {
     int rc;
     int up_rc;
+    int64_t op_start;
     const char *sql;
     test_t row;
 
@@ -505,9 +2416,17 @@ void update_rows_rowid() {
     }
 
     /* 
-    ** Loop through the rows in the select statement
+    ** Loop through the rows in the select statement, timing its steps as well
+    ** as the update's.
     */
-    while ((rc = sqlite3_step(sel_stmt)) == SQLITE_ROW) {
+    for (;;) {
+        op_start = latency_begin();
+        rc = sqlite3_step(sel_stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_ROW) {
+            break;
+        }
+
         row.rowid = sqlite3_column_int64(sel_stmt, 0);
         row.num1 = sqlite3_column_double(sel_stmt, 1);
         row.num2 = sqlite3_column_double(sel_stmt, 2);
@@ -531,7 +2450,9 @@ void update_rows_rowid() {
         sqlite3_bind_double(up_stmt, 4, row.num4);
         sqlite3_bind_int64(up_stmt, 5, row.rowid);
 
+        op_start = latency_begin();
         up_rc = sqlite3_step(up_stmt);
+        latency_end(op_start);
         if (up_rc != SQLITE_DONE) {
             die_db_error();
         }
@@ -540,10 +2461,14 @@ void update_rows_rowid() {
         ** Reset update statement for next row.
         */
         sqlite3_reset(up_stmt);
-        sqlite3_clear_bindings(up_stmt);
+        if (clear_bindings) {
+            sqlite3_clear_bindings(up_stmt);
+        }
     }
 
+    op_start = latency_begin();
     rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
     if (rc != SQLITE_OK) {
         die_db_error();
     }
@@ -554,3 +2479,133 @@ void update_rows_rowid() {
     sqlite3_finalize(sel_stmt);
     sqlite3_finalize(up_stmt);
 }
+
+
+/*
+** Microbenchmark of the per statement API overhead around sqlite3_step, to
+** find the floor for a prepared statement loop:
+**   - sqlite3_bind_double, per call.
+**   - sqlite3_clear_bindings (vdbeUnbind on every parameter), per call.
+**   - sqlite3_reset after a completed INSERT, per call.
+**   - A whole bind/step/reset of "SELECT ?", the cheapest statement there is.
+** Each part is a loop of num_rows calls timed as a whole; reset has to be
+** timed one call at a time, so the cost of reading the clock is measured and
+** subtracted. The bind loops are repeated and the fastest run is kept, since
+** the clear cost is the small difference of two bigger numbers. The INSERT
+** part adds num_rows rows to the Test table.
+*/
+void bind_reset_micro() {
+    int rc;
+    int n = _config.num_rows;
+    int64_t start_ns;
+    int64_t bind_ns, bind_clear_ns, reset_ns = 0, clock_ns, floor_ns;
+    sqlite3_stmt *ins_stmt;
+    sqlite3_stmt *sel_stmt;
+
+    rc = sqlite3_prepare_v3(_db, "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);",
+        -1, SQLITE_PREPARE_PERSISTENT, &ins_stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    rc = sqlite3_prepare_v3(_db, "SELECT ?;", -1, SQLITE_PREPARE_PERSISTENT, &sel_stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    /*
+    ** Bind only, and bind then clear. The difference is the clear.
+    */
+    bind_ns = INT64_MAX;
+    bind_clear_ns = INT64_MAX;
+    for (int rep = 0; rep < MICRO_REPEATS; ++rep) {
+        int64_t ns = time_bind_loop(ins_stmt, n, 0);
+        if (ns < bind_ns) {
+            bind_ns = ns;
+        }
+        ns = time_bind_loop(ins_stmt, n, 1);
+        if (ns < bind_clear_ns) {
+            bind_clear_ns = ns;
+        }
+    }
+
+    /*
+    ** Cost of reading the clock, to take out of the per call reset timing.
+    */
+    start_ns = bench_now_ns();
+    for (int i = 0; i < n; ++i) {
+        bench_now_ns();
+    }
+    clock_ns = (bench_now_ns() - start_ns) / n;
+
+    /*
+    ** Reset after each real INSERT.
+    */
+    rc = sqlite3_exec(_db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    for (int i = 0; i < n; ++i) {
+        char key[25];
+        int len = sprintf(key, "K-%d", i);
+        sqlite3_bind_text(ins_stmt, 1, key, len, SQLITE_STATIC);
+        sqlite3_bind_double(ins_stmt, 2, i);
+        sqlite3_bind_double(ins_stmt, 3, i);
+        sqlite3_bind_double(ins_stmt, 4, i);
+        sqlite3_bind_double(ins_stmt, 5, i);
+
+        rc = sqlite3_step(ins_stmt);
+        if (rc != SQLITE_DONE) {
+            die_db_error();
+        }
+
+        start_ns = bench_now_ns();
+        sqlite3_reset(ins_stmt);
+        reset_ns += bench_now_ns() - start_ns - clock_ns;
+    }
+    rc = sqlite3_exec(_db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    /*
+    ** The complete round trip of the cheapest possible statement.
+    */
+    start_ns = bench_now_ns();
+    for (int i = 0; i < n; ++i) {
+        sqlite3_bind_int(sel_stmt, 1, i);
+        if (sqlite3_step(sel_stmt) != SQLITE_ROW) {
+            die_db_error();
+        }
+        sqlite3_reset(sel_stmt);
+    }
+    floor_ns = bench_now_ns() - start_ns;
+
+    sqlite3_finalize(ins_stmt);
+    sqlite3_finalize(sel_stmt);
+
+    bench_add_metric("bind_double_ns", bind_ns / (4.0 * n));
+    bench_add_metric("clear_bindings_ns", (bind_clear_ns - bind_ns) / (double)n);
+    bench_add_metric("reset_after_insert_ns", reset_ns / (double)n);
+    bench_add_metric("clock_read_ns", (double)clock_ns);
+    bench_add_metric("select_bind_step_reset_ns", floor_ns / (double)n);
+}
+
+
+/*
+** Bind 4 doubles to stmt n times, optionally calling sqlite3_clear_bindings
+** after each set. Returns the elapsed nanoseconds.
+*/
+int64_t time_bind_loop(sqlite3_stmt *stmt, int n, int clear_bindings) {
+    int64_t start_ns = bench_now_ns();
+
+    for (int i = 0; i < n; ++i) {
+        sqlite3_bind_double(stmt, 2, i);
+        sqlite3_bind_double(stmt, 3, i);
+        sqlite3_bind_double(stmt, 4, i);
+        sqlite3_bind_double(stmt, 5, i);
+        if (clear_bindings) {
+            sqlite3_clear_bindings(stmt);
+        }
+    }
+    return bench_now_ns() - start_ns;
+}
@@ -4525,6 +4525,72 @@ extern "C" {
     SQLITE_API int sqlite3_column_bytes16(sqlite3_stmt*, int iCol);
     SQLITE_API int sqlite3_column_type(sqlite3_stmt*, int iCol);
 
+    /*
+    ** CAPI3REF: Fetch Result Rows Into Column Arrays
+    ** METHOD: sqlite3_stmt
+    **
+    ** Benchmark addition, not part of upstream SQLite.
+    **
+    ** sqlite3_step_batch(S, N, C, M, R) steps [prepared statement] S up to M
+    ** times and copies result columns 0 to N-1 of every row into the column
+    ** arrays C[0] to C[N-1], so a whole batch of rows costs one call instead
+    ** of a sqlite3_column_*() call per value. The number of rows copied is
+    ** written to *R. Each column array has the type given by its eType:
+    **
+    ** <ul>
+    ** <li> SQLITE_INTEGER: aData is a sqlite3_int64[M].
+    ** <li> SQLITE_FLOAT: aData is a double[M].
+    ** <li> SQLITE_TEXT: aData is a buffer of nData bytes and aOffset an
+    **      int[M+1]. Row r's value is aData[aOffset[r]] to aData[aOffset[r+1]],
+    **      UTF-8 without a NUL terminator. BLOBs are copied as they are.
+    ** </ul>
+    **
+    ** Values of another type are converted as sqlite3_column_int64(),
+    ** sqlite3_column_double() or sqlite3_column_text() would. If aNull is not
+    ** NULL, aNull[r] is set to 1 for NULL values and to 0 otherwise.
+    **
+    ** The return value is SQLITE_ROW if all M rows were copied or a text
+    ** buffer filled up, and there may be more rows. A row that did not fit is
+    ** left in the statement and is the first row of the next call. It is
+    ** SQLITE_DONE once the statement has run to completion, with any rows
+    ** before the end copied. SQLITE_TOOBIG means a single row doesn't fit in
+    ** an empty text buffer, and SQLITE_RANGE that N is more than the number of
+    ** result columns. Any other value is the error sqlite3_step() returned.
+    ** Calling sqlite3_step() or sqlite3_reset() drops a row left behind.
+    */
+    typedef struct sqlite3_batch_column sqlite3_batch_column;
+    struct sqlite3_batch_column {
+        int eType;                      /* SQLITE_INTEGER, SQLITE_FLOAT or SQLITE_TEXT */
+        void *aData;                    /* Values, see above */
+        int nData;                      /* SQLITE_TEXT: size of aData in bytes */
+        int *aOffset;                   /* SQLITE_TEXT: start of each value in aData */
+        unsigned char *aNull;           /* If not NULL, set to 1 for each NULL */
+    };
+    SQLITE_API int sqlite3_step_batch(sqlite3_stmt*, int nCol, sqlite3_batch_column *aCol, int nRowMax,
+        int *pnRow);
+
+    /*
+    ** CAPI3REF: Run A Statement Once Per Row Of Column Arrays
+    ** METHOD: sqlite3_stmt
+    **
+    ** Benchmark addition, not part of upstream SQLite.
+    **
+    ** sqlite3_exec_batch(S, N, C, M, R) runs [prepared statement] S (typically
+    ** an INSERT) M times, with parameters 1 to N bound to row r of the column
+    ** arrays C[0] to C[N-1] on run r, in the same layout as
+    ** [sqlite3_step_batch()] fills them. Text is bound without a copy, as
+    ** with SQLITE_STATIC. It replaces M rounds of sqlite3_bind_*() calls,
+    ** sqlite3_step() and sqlite3_reset() with one call. S must not be running
+    ** (reset, or never stepped) when it is called.
+    **
+    ** Returns SQLITE_OK once all M rows have run, with M written to *R.
+    ** Otherwise it stops at the first row that fails, writes the number of
+    ** rows that ran to *R and returns the error. Either way S is left reset,
+    ** with parameters 1 to N bound to NULL.
+    */
+    SQLITE_API int sqlite3_exec_batch(sqlite3_stmt*, int nCol, const sqlite3_batch_column *aCol, int nRow,
+        int *pnDone);
+
     /*
     ** CAPI3REF: Destroy A Prepared Statement Object
     ** DESTRUCTOR: sqlite3_stmt
@@ -7257,6 +7323,16 @@ extern "C" {
     ** highwater mark associated with SQLITE_DBSTATUS_CACHE_WRITE is always 0.
     ** </dd>
     **
+    ** [[SQLITE_DBSTATUS_CACHE_SPILL]] ^(<dt>SQLITE_DBSTATUS_CACHE_SPILL</dt>
+    ** <dd>This parameter returns the number of dirty cache entries that have
+    ** been written to disk in the middle of a transaction due to the page
+    ** cache overflowing. Transactions are more efficient if they are written
+    ** to disk all at once. When pages spill mid-transaction, that introduces
+    ** additional overhead. This parameter can be used help identify
+    ** inefficiencies that can be resolve by increasing the cache size.
+    ** (Benchmark addition, backported from later versions of SQLite.)
+    ** </dd>
+    **
     ** [[SQLITE_DBSTATUS_DEFERRED_FKS]] ^(<dt>SQLITE_DBSTATUS_DEFERRED_FKS</dt>
     ** <dd>This parameter returns zero for the current value if and only if
     ** all foreign key constraints (deferred or immediate) have been
@@ -7276,7 +7352,8 @@ extern "C" {
 #define SQLITE_DBSTATUS_CACHE_WRITE          9
 #define SQLITE_DBSTATUS_DEFERRED_FKS        10
 #define SQLITE_DBSTATUS_CACHE_USED_SHARED   11
-#define SQLITE_DBSTATUS_MAX                 11   /* Largest defined DBSTATUS */
+#define SQLITE_DBSTATUS_CACHE_SPILL         12
+#define SQLITE_DBSTATUS_MAX                 12   /* Largest defined DBSTATUS */
 
 
     /*
@@ -0,0 +1,141 @@
+/*
+** test_batch - Moving rows between SQLite and column arrays in batches.
+**
+** update_rows_rowid reads each row with five sqlite3_column_* calls, and
+** every one of them takes the connection's mutex, checks the column number
+** and converts the value through the sqlite3_value API. fetch_rows is that
+** read loop on its own; fetch_batch reads the same rows with
+** sqlite3_step_batch() (a benchmark addition to sqlite3.c), which copies up
+** to FETCH_BATCH_ROWS rows straight from the result registers into an int64
+** array and four double arrays per call. Both time their latency per
+** FETCH_BATCH_ROWS rows, so they read the clock equally often.
+*/
+#include "test_batch.h"
+#include "bench.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FETCH_BATCH_ROWS 256
+#define FETCH_COLUMNS 5
+
+
+/*
+** Function prototypes.
+*/
+static sqlite3_stmt *prepare_fetch();
+static void finish_fetch(sqlite3_stmt *stmt, int rc, int64_t rows, double checksum);
+
+
+/*
+** The SELECT loop of update_rows_rowid, without the UPDATE. The latency
+** histogram holds the time per FETCH_BATCH_ROWS rows, as in fetch_batch.
+*/
+void fetch_rows() {
+    sqlite3_stmt *stmt = prepare_fetch();
+    int rc;
+    int n;
+    int64_t rows = 0;
+    int64_t batches = 0;
+    int64_t op_start;
+    double checksum = 0.0;
+    int64_t rowid;
+    double num1, num2, num3, num4;
+
+    do {
+        op_start = latency_begin();
+        for (n = 0; n < FETCH_BATCH_ROWS; ++n) {
+            rc = sqlite3_step(stmt);
+            if (rc != SQLITE_ROW) {
+                break;
+            }
+
+            rowid = sqlite3_column_int64(stmt, 0);
+            num1 = sqlite3_column_double(stmt, 1);
+            num2 = sqlite3_column_double(stmt, 2);
+            num3 = sqlite3_column_double(stmt, 3);
+            num4 = sqlite3_column_double(stmt, 4);
+
+            checksum += rowid + num1 + num2 + num3 + num4;
+        }
+        latency_end(op_start);
+        rows += n;
+        ++batches;
+    } while (rc == SQLITE_ROW);
+
+    bench_add_metric("batches", (double)batches);
+    finish_fetch(stmt, rc, rows, checksum);
+}
+
+
+/*
+** The same rows, FETCH_BATCH_ROWS at a time. The latency histogram holds
+** the time per batch.
+*/
+void fetch_batch() {
+    sqlite3_stmt *stmt = prepare_fetch();
+    sqlite3_batch_column columns[FETCH_COLUMNS];
+    sqlite3_int64 rowid[FETCH_BATCH_ROWS];
+    double num[FETCH_COLUMNS - 1][FETCH_BATCH_ROWS];
+    int rc;
+    int n;
+    int64_t rows = 0;
+    int64_t batches = 0;
+    int64_t op_start;
+    double checksum = 0.0;
+
+    memset(columns, 0, sizeof(columns));
+    columns[0].eType = SQLITE_INTEGER;
+    columns[0].aData = rowid;
+    for (int c = 1; c < FETCH_COLUMNS; ++c) {
+        columns[c].eType = SQLITE_FLOAT;
+        columns[c].aData = num[c - 1];
+    }
+
+    do {
+        op_start = latency_begin();
+        rc = sqlite3_step_batch(stmt, FETCH_COLUMNS, columns, FETCH_BATCH_ROWS, &n);
+        latency_end(op_start);
+
+        for (int i = 0; i < n; ++i) {
+            checksum += rowid[i] + num[0][i] + num[1][i] + num[2][i] + num[3][i];
+        }
+        rows += n;
+        ++batches;
+    } while (rc == SQLITE_ROW);
+
+    bench_add_metric("batches", (double)batches);
+    finish_fetch(stmt, rc, rows, checksum);
+}
+
+
+/*
+** Prepare the SELECT update_rows_rowid reads its rows with.
+*/
+static sqlite3_stmt *prepare_fetch() {
+    sqlite3_stmt *stmt;
+    int rc;
+
+    rc = sqlite3_prepare_v3(bench_db(), "SELECT _rowid_, num1, num2, num3, num4 FROM Test ORDER BY _rowid_;",
+        -1, 0, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    return stmt;
+}
+
+
+/*
+** Check how the fetch loop ended, and report the rows read and a checksum of
+** the values, which has to match between the two tests.
+*/
+static void finish_fetch(sqlite3_stmt *stmt, int rc, int64_t rows, double checksum) {
+    if (rc != SQLITE_DONE) {
+        die_db_error();
+    }
+    sqlite3_finalize(stmt);
+
+    bench_add_metric("checksum", checksum);
+    bench_set_rows(rows);
+}
@@ -0,0 +1,13 @@
+/*
+** test_batch - Moving rows between SQLite and column arrays in batches.
+*/
+#ifndef TEST_BATCH_H
+#define TEST_BATCH_H
+
+/*
+** Function prototypes.
+*/
+void fetch_rows();
+void fetch_batch();
+
+#endif
@@ -0,0 +1,365 @@
+/*
+** test_concurrent - Multi-threaded readers and writers against one WAL database.
+**
+** Unlike the rest of the tests, every thread here has its own connection.
+** Reader threads do point lookups by rowid for as long as the writers are
+** running, and writer threads update every row of the Test table in small
+** transactions. This is the production pattern of N readers against one
+** writer, and shows how much reads slow down (walTryBeginRead retries, lock
+** contention) while writes and checkpoints are going on.
+*/
+#include "test_concurrent.h"
+#include "bench.h"
+#include "bench_rand.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** Rows updated per writer transaction, and the WAL size (in frames) at which
+** a writer runs a checkpoint. 1000 frames is SQLite's default auto-checkpoint.
+*/
+#define CONCURRENT_WRITE_BATCH 100
+#define CONCURRENT_CHECKPOINT_FRAMES 1000
+
+
+/*
+** State shared by all of the threads of one run.
+*/
+typedef struct shared_t {
+    int64_t num_rows;
+    int64_t origin_ns;
+    int64_t series_interval_ns;
+    int writers_running;
+} shared_t;
+
+
+/*
+** Per-thread state and counters. Only the owning thread writes to these until
+** it has been joined.
+*/
+typedef struct worker_t {
+    bench_thread_t thread;
+    shared_t *shared;
+    int64_t first_row;
+    int64_t last_row;
+    bench_rand_t rand;
+
+    uint64_t ops;
+    uint64_t busy_retries;
+    uint64_t checkpoints;
+    int64_t checkpoint_total_ns;
+    int64_t checkpoint_max_ns;
+    bench_hist_t latency;
+} worker_t;
+
+
+/*
+** Function prototypes.
+*/
+static void reader_main(void *arg);
+static void writer_main(void *arg);
+static int wal_hook(void *arg, sqlite3 *db, const char *db_name, int frames);
+static void exec_retry(sqlite3 *db, const char *sql, worker_t *worker);
+static int step_retry(sqlite3 *db, sqlite3_stmt *stmt, worker_t *worker);
+
+
+/*
+** Put the database in WAL mode and fill the Test table, like the update tests.
+** journal_mode=WAL is persistent, so the worker connections pick it up.
+*/
+void setup_concurrent_test() {
+    int rc;
+
+    rc = sqlite3_exec(bench_db(), "PRAGMA journal_mode = WAL;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    setup_update_test();
+}
+
+
+/*
+** Run --readers reader threads and --writers writer threads. The writers
+** split the rows of the Test table between them; readers run until the last
+** writer finishes. The test's latency histogram holds the writers' UPDATE
+** and COMMIT times, and read latency is reported as metrics.
+*/
+void concurrent_wal() {
+    const bench_config_t *config = bench_config();
+    shared_t shared;
+    worker_t *readers;
+    worker_t *writers;
+    bench_hist_t read_latency;
+    bench_hist_t *write_latency;
+    int64_t start_ns, elapsed_ns;
+    int64_t rows_per_writer;
+    uint64_t reads = 0, writes = 0;
+    uint64_t reader_busy = 0, writer_busy = 0;
+    uint64_t checkpoints = 0;
+    int64_t checkpoint_total_ns = 0, checkpoint_max_ns = 0;
+    double elapsed_sec;
+
+    memset(&shared, 0, sizeof(shared));
+    shared.num_rows = config->num_rows;
+    shared.series_interval_ns = (int64_t)config->series_interval_ms * 1000000;
+    shared.writers_running = config->writers;
+
+    readers = calloc(config->readers > 0 ? config->readers : 1, sizeof(*readers));
+    writers = calloc(config->writers, sizeof(*writers));
+    if (readers == NULL || writers == NULL) {
+        printf("Out of memory starting %d readers and %d writers.\n", config->readers, config->writers);
+        exit(-1);
+    }
+
+    start_ns = bench_now_ns();
+    shared.origin_ns = start_ns;
+
+    /*
+    ** Readers first so the writers start against an already busy database.
+    */
+    for (int i = 0; i < config->readers; ++i) {
+        readers[i].shared = &shared;
+        bench_rand_seed(&readers[i].rand, config->seed + (uint64_t)i);
+        if (bench_thread_start(&readers[i].thread, reader_main, &readers[i]) != 0) {
+            printf("Unable to start reader thread %d.\n", i);
+            exit(-1);
+        }
+    }
+
+    rows_per_writer = (config->num_rows + config->writers - 1) / config->writers;
+    for (int i = 0; i < config->writers; ++i) {
+        writers[i].shared = &shared;
+        writers[i].first_row = 1 + i * rows_per_writer;
+        writers[i].last_row = writers[i].first_row + rows_per_writer - 1;
+        if (writers[i].last_row > config->num_rows) {
+            writers[i].last_row = config->num_rows;
+        }
+        if (bench_thread_start(&writers[i].thread, writer_main, &writers[i]) != 0) {
+            printf("Unable to start writer thread %d.\n", i);
+            exit(-1);
+        }
+    }
+
+    for (int i = 0; i < config->writers; ++i) {
+        bench_thread_join(&writers[i].thread);
+    }
+    elapsed_ns = bench_now_ns() - start_ns;
+    for (int i = 0; i < config->readers; ++i) {
+        bench_thread_join(&readers[i].thread);
+    }
+
+    /*
+    ** Combine the per-thread results.
+    */
+    bench_hist_init(&read_latency, 0);
+    write_latency = bench_latency();
+
+    for (int i = 0; i < config->readers; ++i) {
+        reads += readers[i].ops;
+        reader_busy += readers[i].busy_retries;
+        bench_hist_merge(&read_latency, &readers[i].latency);
+        bench_hist_free(&readers[i].latency);
+    }
+    for (int i = 0; i < config->writers; ++i) {
+        writes += writers[i].ops;
+        writer_busy += writers[i].busy_retries;
+        checkpoints += writers[i].checkpoints;
+        checkpoint_total_ns += writers[i].checkpoint_total_ns;
+        if (writers[i].checkpoint_max_ns > checkpoint_max_ns) {
+            checkpoint_max_ns = writers[i].checkpoint_max_ns;
+        }
+        if (write_latency != NULL) {
+            bench_hist_merge(write_latency, &writers[i].latency);
+        }
+        bench_hist_free(&writers[i].latency);
+    }
+
+    elapsed_sec = elapsed_ns / 1e9;
+    bench_add_metric("readers", config->readers);
+    bench_add_metric("writers", config->writers);
+    bench_add_metric("reads", (double)reads);
+    bench_add_metric("reads_per_sec", elapsed_sec > 0 ? reads / elapsed_sec : 0.0);
+    bench_add_metric("writes_per_sec", elapsed_sec > 0 ? writes / elapsed_sec : 0.0);
+    bench_add_metric("read_p50_usec", bench_hist_percentile(&read_latency, 50.0) / 1e3);
+    bench_add_metric("read_p99_usec", bench_hist_percentile(&read_latency, 99.0) / 1e3);
+    bench_add_metric("read_p99.9_usec", bench_hist_percentile(&read_latency, 99.9) / 1e3);
+    bench_add_metric("read_max_usec", read_latency.max_ns / 1e3);
+    bench_add_metric("reader_busy_retries", (double)reader_busy);
+    bench_add_metric("reader_busy_per_1k_reads", reads ? reader_busy * 1000.0 / reads : 0.0);
+    bench_add_metric("writer_busy_retries", (double)writer_busy);
+    bench_add_metric("writer_busy_per_1k_writes", writes ? writer_busy * 1000.0 / writes : 0.0);
+    bench_add_metric("checkpoints", (double)checkpoints);
+    bench_add_metric("checkpoint_total_ms", checkpoint_total_ns / 1e6);
+    bench_add_metric("checkpoint_max_ms", checkpoint_max_ns / 1e6);
+
+    bench_hist_free(&read_latency);
+    free(readers);
+    free(writers);
+}
+
+
+/*
+** Reader thread: point lookups of random rows until the writers are done.
+** Each lookup is its own read transaction, so every one goes through
+** walTryBeginRead() and competes with the writers for the WAL read marks.
+*/
+static void reader_main(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    shared_t *shared = worker->shared;
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int64_t op_start;
+
+    bench_hist_init(&worker->latency, shared->series_interval_ns);
+    bench_hist_set_origin(&worker->latency, shared->origin_ns);
+
+    db = open_connection();
+
+    rc = sqlite3_prepare_v3(db, "SELECT num1, num2, num3, num4 FROM Test WHERE _rowid_ = ?;", -1, 0, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    while (bench_atomic_load(&shared->writers_running) > 0) {
+        sqlite3_bind_int64(stmt, 1, 1 + (int64_t)(bench_rand_next(&worker->rand) % (uint64_t)shared->num_rows));
+
+        op_start = bench_now_ns();
+        rc = step_retry(db, stmt, worker);
+        bench_hist_record(&worker->latency, op_start, bench_now_ns());
+
+        if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+            die_conn_error(db);
+        }
+        sqlite3_reset(stmt);
+        ++worker->ops;
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+}
+
+
+/*
+** Writer thread: update this writer's share of the rows, committing every
+** CONCURRENT_WRITE_BATCH rows. BEGIN IMMEDIATE takes the write lock up front
+** so contention between writers shows up as busy retries on BEGIN.
+*/
+static void writer_main(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    shared_t *shared = worker->shared;
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int64_t op_start;
+    int in_batch = 0;
+
+    bench_hist_init(&worker->latency, shared->series_interval_ns);
+    bench_hist_set_origin(&worker->latency, shared->origin_ns);
+
+    db = open_connection();
+
+    /*
+    ** Replaces the built in auto-checkpoint so checkpoints can be counted and
+    ** timed. Still runs inside COMMIT, just like the built in one.
+    */
+    sqlite3_wal_hook(db, wal_hook, worker);
+
+    rc = sqlite3_prepare_v3(db, "UPDATE Test SET num1 = num1 + 1, num2 = num2 + 1, "
+        "num3 = num3 + 1, num4 = num4 + 1 WHERE _rowid_ = ?;", -1, 0, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    for (int64_t row = worker->first_row; row <= worker->last_row; ++row) {
+        if (in_batch == 0) {
+            exec_retry(db, "BEGIN IMMEDIATE TRANSACTION;", worker);
+        }
+
+        sqlite3_bind_int64(stmt, 1, row);
+
+        op_start = bench_now_ns();
+        rc = step_retry(db, stmt, worker);
+        bench_hist_record(&worker->latency, op_start, bench_now_ns());
+
+        if (rc != SQLITE_DONE) {
+            die_conn_error(db);
+        }
+        sqlite3_reset(stmt);
+        ++worker->ops;
+
+        if (++in_batch == CONCURRENT_WRITE_BATCH || row == worker->last_row) {
+            op_start = bench_now_ns();
+            exec_retry(db, "COMMIT TRANSACTION;", worker);
+            bench_hist_record(&worker->latency, op_start, bench_now_ns());
+            in_batch = 0;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    bench_atomic_add(&shared->writers_running, -1);
+}
+
+
+/*
+** Called after each commit with the number of frames in the WAL. Runs a
+** PASSIVE checkpoint (what auto-checkpoint does) once the WAL is big enough.
+*/
+static int wal_hook(void *arg, sqlite3 *db, const char *db_name, int frames) {
+    worker_t *worker = (worker_t *)arg;
+    int64_t start_ns, elapsed_ns;
+
+    if (frames < CONCURRENT_CHECKPOINT_FRAMES) {
+        return SQLITE_OK;
+    }
+
+    start_ns = bench_now_ns();
+    sqlite3_wal_checkpoint_v2(db, db_name, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    elapsed_ns = bench_now_ns() - start_ns;
+
+    ++worker->checkpoints;
+    worker->checkpoint_total_ns += elapsed_ns;
+    if (elapsed_ns > worker->checkpoint_max_ns) {
+        worker->checkpoint_max_ns = elapsed_ns;
+    }
+    return SQLITE_OK;
+}
+
+
+/*
+** sqlite3_exec() that retries (and counts) SQLITE_BUSY / SQLITE_LOCKED rather
+** than using a busy timeout, so the retry rate can be reported.
+*/
+static void exec_retry(sqlite3 *db, const char *sql, worker_t *worker) {
+    int rc;
+
+    while ((rc = sqlite3_exec(db, sql, NULL, NULL, NULL)) == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        ++worker->busy_retries;
+        bench_thread_yield();
+    }
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/*
+** sqlite3_step() that retries (and counts) SQLITE_BUSY / SQLITE_LOCKED.
+*/
+static int step_retry(sqlite3 *db, sqlite3_stmt *stmt, worker_t *worker) {
+    int rc;
+
+    while ((rc = sqlite3_step(stmt)) == SQLITE_BUSY || rc == SQLITE_LOCKED) {
+        ++worker->busy_retries;
+        sqlite3_reset(stmt);
+        bench_thread_yield();
+    }
+    return rc;
+}
+
@@ -0,0 +1,13 @@
+/*
+** test_concurrent - Multi-threaded readers and writers against one WAL database.
+*/
+#ifndef TEST_CONCURRENT_H
+#define TEST_CONCURRENT_H
+
+/*
+** Function prototypes.
+*/
+void setup_concurrent_test();
+void concurrent_wal();
+
+#endif
@@ -0,0 +1,172 @@
+/*
+** test_index - Building the key index after a bulk load.
+**
+** Every insert into a table with an index on key also inserts into the
+** index, at a random spot in it, so a big load keeps touching pages all
+** over the index btree. index_deferred loads the Test table with no index
+** and then runs CREATE UNIQUE INDEX, which sorts all of the keys with the
+** VdbeSorter (spilling sorted runs to temp files and merging them, on
+** PRAGMA threads worker threads) and writes the index out in order.
+** index_maintained is the same load into a table that has the index from the
+** start. Both load the no_index layout, whatever --schema says, and only run
+** in the first --schema pass.
+*/
+#include "test_index.h"
+#include "bench.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INDEX_KEY_SIZE 25
+
+
+/*
+** Function prototypes.
+*/
+static void create_index_table(int with_index);
+static void create_key_index();
+static double load_rows();
+
+
+/*
+** Setup for index_deferred: the Test table without any index.
+*/
+void setup_deferred_index_test() {
+    build_dataset();
+    create_index_table(0);
+}
+
+
+/*
+** Setup for index_maintained: the Test table with the unique key index
+** already on it.
+*/
+void setup_maintained_index_test() {
+    build_dataset();
+    create_index_table(1);
+}
+
+
+/*
+** Load every row, then index them. Reported: load_sec, create_index_sec, and
+** the sorter_threads the CREATE INDEX was allowed.
+*/
+void index_deferred() {
+    const bench_config_t *config = bench_config();
+    sqlite3 *db = bench_db();
+    char sql[64];
+    int threads = config->sorter_threads >= 0 ? config->sorter_threads : bench_cpu_count();
+    int64_t start_ns, op_start;
+
+    bench_add_metric("load_sec", load_rows());
+
+    /*
+    ** SQLite clamps this to SQLITE_MAX_WORKER_THREADS (8 unless the build
+    ** says otherwise), so read back what it actually took.
+    */
+    snprintf(sql, sizeof(sql), "PRAGMA threads = %d;", threads);
+    if (sqlite3_exec(db, sql, NULL, NULL, NULL) != SQLITE_OK) {
+        die_db_error();
+    }
+    bench_add_metric("sorter_threads", sqlite3_limit(db, SQLITE_LIMIT_WORKER_THREADS, -1));
+
+    start_ns = bench_now_ns();
+    op_start = latency_begin();
+    create_key_index();
+    latency_end(op_start);
+    bench_add_metric("create_index_sec", (bench_now_ns() - start_ns) / 1e9);
+}
+
+
+/*
+** The same load with the index kept up to date row by row.
+*/
+void index_maintained() {
+    bench_add_metric("load_sec", load_rows());
+}
+
+
+/*
+** Create the Test table in the no_index layout, and the unique key index on
+** it if with_index is set.
+*/
+static void create_index_table(int with_index) {
+    create_schema_table(bench_db(), "no_index");
+
+    if (with_index) {
+        create_key_index();
+    }
+}
+
+
+/*
+** CREATE UNIQUE INDEX on key, the same index the int_pk schema has.
+*/
+static void create_key_index() {
+    int rc;
+
+    rc = sqlite3_exec(bench_db(), "CREATE UNIQUE INDEX TestKey ON Test(key);", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+}
+
+
+/*
+** Insert every row in one transaction with a prepared statement, as
+** insert_rows_xact_prepared does. Returns how long it took in seconds.
+*/
+static double load_rows() {
+    const bench_config_t *config = bench_config();
+    const bench_dataset_t *data = bench_dataset();
+    sqlite3 *db = bench_db();
+    const char *sql;
+    char key[INDEX_KEY_SIZE];
+    sqlite3_stmt *stmt;
+    int rc;
+    int key_len;
+    int64_t start_ns, op_start;
+
+    start_ns = bench_now_ns();
+
+    rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    for (int i = 0; i < config->num_rows; ++i) {
+        key_len = sprintf(key, "K-%d", i);
+        sqlite3_bind_text(stmt, 1, key, key_len, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 2, data->num1[i]);
+        sqlite3_bind_double(stmt, 3, data->num2[i]);
+        sqlite3_bind_double(stmt, 4, data->num3[i]);
+        sqlite3_bind_double(stmt, 5, data->num4[i]);
+
+        op_start = latency_begin();
+        rc = sqlite3_step(stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_DONE) {
+            die_db_error();
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+
+    op_start = latency_begin();
+    rc = sqlite3_exec(db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    latency_end(op_start);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    return (bench_now_ns() - start_ns) / 1e9;
+}
@@ -0,0 +1,15 @@
+/*
+** test_index - Building the key index after a bulk load.
+*/
+#ifndef TEST_INDEX_H
+#define TEST_INDEX_H
+
+/*
+** Function prototypes.
+*/
+void setup_deferred_index_test();
+void setup_maintained_index_test();
+void index_deferred();
+void index_maintained();
+
+#endif
@@ -0,0 +1,302 @@
+/*
+** test_ingest - Many producer threads inserting into one database.
+**
+** Every producer inserts its share of the rows as requests of
+** INGEST_REQUEST_ROWS rows and waits for each request to be committed before
+** sending the next, like a service acknowledging writes. ingest_group sends
+** them through ingest_queue to one writer that group commits; ingest_naive
+** has every producer run its own BEGIN / INSERT / COMMIT on its own
+** connection, so the producers take turns on SQLite's write lock and pay a
+** commit each. The latency histogram holds the time from sending a request
+** to it being committed.
+*/
+#include "test_ingest.h"
+#include "bench.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include "ingest_queue.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** Rows per producer request.
+*/
+#define INGEST_REQUEST_ROWS 10
+#define INGEST_KEY_SIZE 25
+
+
+/*
+** State shared by all of the producers of one run.
+*/
+typedef struct shared_t {
+    ingest_queue_t *queue;
+    int64_t origin_ns;
+    int64_t series_interval_ns;
+} shared_t;
+
+
+/*
+** Per-producer state. Only the owning thread writes to these until it has
+** been joined.
+*/
+typedef struct producer_t {
+    bench_thread_t thread;
+    shared_t *shared;
+    int first_row;
+    int last_row;
+    ingest_row_t rows[INGEST_REQUEST_ROWS];
+    ingest_ticket_t ticket;
+
+    uint64_t commits;
+    uint64_t busy_retries;
+    bench_hist_t latency;
+    bench_hist_t commit_latency;
+} producer_t;
+
+
+/*
+** Function prototypes.
+*/
+static void run_producers(shared_t *shared, void(*fun)(void *arg));
+static void group_producer_main(void *arg);
+static void naive_producer_main(void *arg);
+static void exec_retry(sqlite3 *db, const char *sql, producer_t *producer);
+static void add_commit_metrics(uint64_t rows, uint64_t commits, const bench_hist_t *commit_latency);
+
+
+/*
+** Producers -> lock-free queue -> one writer committing every --group-rows
+** rows, or once a transaction is --group-delay-us microseconds old.
+*/
+void ingest_group() {
+    const bench_config_t *config = bench_config();
+    ingest_queue_t queue;
+    shared_t shared;
+
+    memset(&shared, 0, sizeof(shared));
+    shared.queue = &queue;
+
+    ingest_queue_start(&queue, bench_db(), config->group_rows, (int64_t)config->group_delay_us * 1000);
+    run_producers(&shared, group_producer_main);
+    ingest_queue_stop(&queue);
+
+    add_commit_metrics((uint64_t)queue.rows, (uint64_t)queue.commits, &queue.commit_latency);
+    bench_add_metric("writer_empty_polls", (double)queue.empty_polls);
+    ingest_queue_free(&queue);
+}
+
+
+/*
+** Producers each with their own connection and their own transactions.
+*/
+void ingest_naive() {
+    shared_t shared;
+
+    memset(&shared, 0, sizeof(shared));
+    run_producers(&shared, naive_producer_main);
+}
+
+
+/*
+** Start --producers threads running fun, with the rows split evenly between
+** them, wait for them all and fold their latencies into the test's. The
+** naive producers' commit counts and times are reported here; the group
+** commit ones belong to the queue.
+*/
+static void run_producers(shared_t *shared, void(*fun)(void *arg)) {
+    const bench_config_t *config = bench_config();
+    producer_t *producers;
+    bench_hist_t commit_latency;
+    bench_hist_t *latency = bench_latency();
+    int rows_per_producer;
+    uint64_t commits = 0, busy_retries = 0;
+
+    producers = calloc(config->producers, sizeof(*producers));
+    if (producers == NULL) {
+        printf("Out of memory starting %d producers.\n", config->producers);
+        exit(-1);
+    }
+
+    shared->series_interval_ns = (int64_t)config->series_interval_ms * 1000000;
+    shared->origin_ns = bench_now_ns();
+
+    rows_per_producer = (config->num_rows + config->producers - 1) / config->producers;
+    for (int i = 0; i < config->producers; ++i) {
+        producers[i].shared = shared;
+        producers[i].first_row = i * rows_per_producer;
+        producers[i].last_row = producers[i].first_row + rows_per_producer;
+        if (producers[i].last_row > config->num_rows) {
+            producers[i].last_row = config->num_rows;
+        }
+        if (bench_thread_start(&producers[i].thread, fun, &producers[i]) != 0) {
+            printf("Unable to start producer thread %d.\n", i);
+            exit(-1);
+        }
+    }
+    for (int i = 0; i < config->producers; ++i) {
+        bench_thread_join(&producers[i].thread);
+    }
+
+    bench_hist_init(&commit_latency, 0);
+    for (int i = 0; i < config->producers; ++i) {
+        commits += producers[i].commits;
+        busy_retries += producers[i].busy_retries;
+        if (latency != NULL) {
+            bench_hist_merge(latency, &producers[i].latency);
+        }
+        bench_hist_merge(&commit_latency, &producers[i].commit_latency);
+        bench_hist_free(&producers[i].latency);
+        bench_hist_free(&producers[i].commit_latency);
+    }
+
+    bench_add_metric("producers", config->producers);
+    if (shared->queue == NULL) {
+        add_commit_metrics((uint64_t)config->num_rows, commits, &commit_latency);
+        bench_add_metric("busy_retries", (double)busy_retries);
+    }
+
+    bench_hist_free(&commit_latency);
+    free(producers);
+}
+
+
+/*
+** Producer for ingest_group: push a request's rows against one ticket, then
+** wait for the writer to commit them.
+*/
+static void group_producer_main(void *arg) {
+    producer_t *producer = (producer_t *)arg;
+    shared_t *shared = producer->shared;
+    const bench_dataset_t *data = bench_dataset();
+    int64_t op_start;
+    int n;
+
+    bench_hist_init(&producer->latency, shared->series_interval_ns);
+    bench_hist_set_origin(&producer->latency, shared->origin_ns);
+    bench_hist_init(&producer->commit_latency, 0);
+
+    for (int i = producer->first_row; i < producer->last_row; i += n) {
+        n = producer->last_row - i < INGEST_REQUEST_ROWS ? producer->last_row - i : INGEST_REQUEST_ROWS;
+
+        for (int j = 0; j < n; ++j) {
+            ingest_row_t *row = &producer->rows[j];
+            row->ticket = &producer->ticket;
+            row->id = i + j;
+            row->num1 = data->num1[i + j];
+            row->num2 = data->num2[i + j];
+            row->num3 = data->num3[i + j];
+            row->num4 = data->num4[i + j];
+        }
+
+        op_start = bench_now_ns();
+        bench_atomic_store(&producer->ticket.pending, n);
+        for (int j = 0; j < n; ++j) {
+            ingest_queue_push(shared->queue, &producer->rows[j]);
+        }
+        ingest_queue_wait(&producer->ticket);
+        bench_hist_record(&producer->latency, op_start, bench_now_ns());
+    }
+}
+
+
+/*
+** Producer for ingest_naive: one transaction per request on a private
+** connection. BEGIN IMMEDIATE takes the write lock up front, so producers
+** queue on SQLITE_BUSY there instead of deadlocking on a lock upgrade.
+*/
+static void naive_producer_main(void *arg) {
+    producer_t *producer = (producer_t *)arg;
+    shared_t *shared = producer->shared;
+    const bench_dataset_t *data = bench_dataset();
+    const char *sql;
+    char key[INGEST_KEY_SIZE];
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int key_len;
+    int n;
+    int64_t op_start, commit_start;
+
+    bench_hist_init(&producer->latency, shared->series_interval_ns);
+    bench_hist_set_origin(&producer->latency, shared->origin_ns);
+    bench_hist_init(&producer->commit_latency, 0);
+
+    db = open_connection();
+
+    /*
+    ** Preparing reads the schema, which needs a shared lock another
+    ** producer's COMMIT can be holding off.
+    */
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    while ((rc = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL)) == SQLITE_BUSY) {
+        ++producer->busy_retries;
+        bench_thread_yield();
+    }
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    for (int i = producer->first_row; i < producer->last_row; i += n) {
+        n = producer->last_row - i < INGEST_REQUEST_ROWS ? producer->last_row - i : INGEST_REQUEST_ROWS;
+
+        op_start = bench_now_ns();
+        exec_retry(db, "BEGIN IMMEDIATE TRANSACTION;", producer);
+
+        for (int j = i; j < i + n; ++j) {
+            key_len = sprintf(key, "K-%d", j);
+            sqlite3_bind_text(stmt, 1, key, key_len, SQLITE_STATIC);
+            sqlite3_bind_double(stmt, 2, data->num1[j]);
+            sqlite3_bind_double(stmt, 3, data->num2[j]);
+            sqlite3_bind_double(stmt, 4, data->num3[j]);
+            sqlite3_bind_double(stmt, 5, data->num4[j]);
+
+            rc = sqlite3_step(stmt);
+            if (rc != SQLITE_DONE) {
+                die_conn_error(db);
+            }
+            sqlite3_reset(stmt);
+        }
+
+        commit_start = bench_now_ns();
+        exec_retry(db, "COMMIT TRANSACTION;", producer);
+        bench_hist_record(&producer->commit_latency, commit_start, bench_now_ns());
+        bench_hist_record(&producer->latency, op_start, bench_now_ns());
+        ++producer->commits;
+    }
+
+    sqlite3_finalize(stmt);
+    if (sqlite3_close(db) != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/*
+** Run a statement, yielding and retrying for as long as another connection
+** holds the lock it needs.
+*/
+static void exec_retry(sqlite3 *db, const char *sql, producer_t *producer) {
+    int rc;
+
+    while ((rc = sqlite3_exec(db, sql, NULL, NULL, NULL)) == SQLITE_BUSY) {
+        ++producer->busy_retries;
+        bench_thread_yield();
+    }
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/*
+** Metrics common to both tests: how many commits the rows took and how long
+** the COMMITs themselves were.
+*/
+static void add_commit_metrics(uint64_t rows, uint64_t commits, const bench_hist_t *commit_latency) {
+    bench_add_metric("commits", (double)commits);
+    bench_add_metric("rows_per_commit", commits ? (double)rows / commits : 0.0);
+    bench_add_metric("commit_p50_usec", bench_hist_percentile(commit_latency, 50.0) / 1e3);
+    bench_add_metric("commit_p99_usec", bench_hist_percentile(commit_latency, 99.0) / 1e3);
+    bench_add_metric("commit_max_usec", commit_latency->max_ns / 1e3);
+}
@@ -0,0 +1,13 @@
+/*
+** test_ingest - Many producer threads inserting into one database.
+*/
+#ifndef TEST_INGEST_H
+#define TEST_INGEST_H
+
+/*
+** Function prototypes.
+*/
+void ingest_group();
+void ingest_naive();
+
+#endif
@@ -0,0 +1,235 @@
+/*
+** test_scan - Read-only scans of the Test table.
+**
+** The update tests read every row too, but their time is mostly the writes.
+** These only read: the table in its own order, the table in key order
+** through the key index, the key index alone (covering), and SUM/AVG
+** aggregates over num1 - num4 that never hand a row to the application.
+** Each reports rows/sec, and bytes/sec of the column values read.
+**
+** scan_decode splits the cost of the table order scan into three passes:
+** walking the table btree without reading any column ("SELECT 1 ... NOT
+** INDEXED", since the planner would rather walk a smaller covering index),
+** decoding every column into the result row without calling a
+** sqlite3_column_* function, and the same with the accessors, so each step
+** costs the difference from the one before. Built with
+** SQLITE_BENCH_DECODE_COUNTERS, the counters in sqlite3.c add how much
+** record header parsing, sqlite3VdbeSerialGet() decoding and
+** sqlite3VdbeRecordUnpack() unpacking each row took.
+*/
+#include "test_scan.h"
+#include "bench.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** What a scan does with each row it is handed.
+*/
+#define SCAN_STEP_ONLY 0
+#define SCAN_READ_COLUMNS 1
+
+/*
+** Bytes of input per row for the aggregate: four REAL columns.
+*/
+#define SCAN_AGGREGATE_ROW_BYTES (4 * sizeof(double))
+
+
+/*
+** Snapshot of the record decoding counters in sqlite3.c.
+*/
+typedef struct decode_counts_t {
+    int64_t header_fields;
+    int64_t serial_get;
+    int64_t record_unpack;
+} decode_counts_t;
+
+
+/*
+** Function prototypes.
+*/
+static void run_scan(const char *sql, int64_t row_bytes);
+static int64_t scan(const char *sql, int mode, int64_t *bytes);
+static void read_decode_counts(decode_counts_t *counts);
+static void add_decode_metrics(const decode_counts_t *start, int64_t rows);
+
+
+/*
+** Every row and column in the table's own order (rowid order, or key order
+** for WITHOUT ROWID).
+*/
+void scan_table() {
+    run_scan("SELECT key, num1, num2, num3, num4 FROM Test;", 0);
+}
+
+
+/*
+** Every row and column in key order: the key index, and a table lookup per
+** row when the table has a rowid.
+*/
+void scan_index() {
+    run_scan("SELECT key, num1, num2, num3, num4 FROM Test ORDER BY key;", 0);
+}
+
+
+/*
+** Every key in key order, straight from the key index.
+*/
+void scan_covering() {
+    run_scan("SELECT key FROM Test ORDER BY key;", 0);
+}
+
+
+/*
+** SUM and AVG of every numeric column. bytes/sec counts the values the
+** aggregates read, not the one row returned.
+*/
+void scan_aggregate() {
+    run_scan("SELECT SUM(num1), AVG(num1), SUM(num2), AVG(num2), "
+        "SUM(num3), AVG(num3), SUM(num4), AVG(num4) FROM Test;", SCAN_AGGREGATE_ROW_BYTES);
+}
+
+
+/*
+** The table order scan in three passes (see above). Reported as
+** walk_ns_per_row, decode_ns_per_row and accessor_ns_per_row, with the
+** decoding counters of the second pass.
+*/
+void scan_decode() {
+    const char *sql = "SELECT key, num1, num2, num3, num4 FROM Test;";
+    decode_counts_t counts;
+    int64_t rows, bytes;
+    int64_t start_ns, walk_ns, decode_ns, read_ns;
+
+    start_ns = bench_now_ns();
+    rows = scan("SELECT 1 FROM Test NOT INDEXED;", SCAN_STEP_ONLY, &bytes);
+    walk_ns = bench_now_ns() - start_ns;
+
+    read_decode_counts(&counts);
+    start_ns = bench_now_ns();
+    scan(sql, SCAN_STEP_ONLY, &bytes);
+    decode_ns = bench_now_ns() - start_ns;
+    add_decode_metrics(&counts, rows);
+
+    start_ns = bench_now_ns();
+    scan(sql, SCAN_READ_COLUMNS, &bytes);
+    read_ns = bench_now_ns() - start_ns;
+
+    if (rows > 0) {
+        bench_add_metric("walk_ns_per_row", (double)walk_ns / rows);
+        bench_add_metric("decode_ns_per_row", (double)(decode_ns - walk_ns) / rows);
+        bench_add_metric("accessor_ns_per_row", (double)(read_ns - decode_ns) / rows);
+    }
+    bench_set_rows(3 * rows);
+}
+
+
+/*
+** Run one scan that reads every column it returns and report its bytes/sec.
+** row_bytes, if not 0, is the bytes read per table row instead of the bytes
+** of the rows returned.
+*/
+static void run_scan(const char *sql, int64_t row_bytes) {
+    decode_counts_t counts;
+    int64_t rows, bytes;
+    int64_t start_ns, elapsed_ns;
+
+    read_decode_counts(&counts);
+    start_ns = bench_now_ns();
+    rows = scan(sql, SCAN_READ_COLUMNS, &bytes);
+    elapsed_ns = bench_now_ns() - start_ns;
+
+    if (row_bytes != 0) {
+        rows = bench_config()->num_rows;
+        bytes = rows * row_bytes;
+    }
+    bench_add_metric("bytes_per_sec", elapsed_ns > 0 ? bytes / (elapsed_ns / 1e9) : 0.0);
+    add_decode_metrics(&counts, rows);
+    bench_set_rows(rows);
+}
+
+
+/*
+** Step through every row of sql. With SCAN_READ_COLUMNS every column is read
+** as its storage class, and its size added to bytes. Returns the number of
+** rows.
+*/
+static int64_t scan(const char *sql, int mode, int64_t *bytes) {
+    sqlite3 *db = bench_db();
+    sqlite3_stmt *stmt;
+    int rc;
+    int columns;
+    int64_t rows = 0;
+    int64_t op_start;
+    volatile double sum = 0.0;
+
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    columns = sqlite3_column_count(stmt);
+    *bytes = 0;
+
+    for (;;) {
+        op_start = latency_begin();
+        rc = sqlite3_step(stmt);
+        latency_end(op_start);
+        if (rc != SQLITE_ROW) {
+            break;
+        }
+        ++rows;
+
+        if (mode == SCAN_READ_COLUMNS) {
+            for (int i = 0; i < columns; ++i) {
+                if (sqlite3_column_type(stmt, i) == SQLITE_TEXT) {
+                    sum += sqlite3_column_text(stmt, i)[0];
+                    *bytes += sqlite3_column_bytes(stmt, i);
+                }
+                else {
+                    sum += sqlite3_column_double(stmt, i);
+                    *bytes += sizeof(double);
+                }
+            }
+        }
+    }
+
+    if (rc != SQLITE_DONE) {
+        die_db_error();
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+
+/*
+** Read the record decoding counters. All 0 without
+** SQLITE_BENCH_DECODE_COUNTERS.
+*/
+static void read_decode_counts(decode_counts_t *counts) {
+    memset(counts, 0, sizeof(*counts));
+#if defined SQLITE_BENCH_DECODE_COUNTERS
+    counts->header_fields = sqlite3_bench_header_fields;
+    counts->serial_get = sqlite3_bench_serial_get;
+    counts->record_unpack = sqlite3_bench_record_unpack;
+#endif
+}
+
+
+/*
+** Add the per row change in the record decoding counters since start as
+** header_fields_per_row, serial_get_per_row and record_unpack_per_row.
+*/
+static void add_decode_metrics(const decode_counts_t *start, int64_t rows) {
+#if defined SQLITE_BENCH_DECODE_COUNTERS
+    decode_counts_t end;
+
+    if (rows <= 0) {
+        return;
+    }
+    read_decode_counts(&end);
+    bench_add_metric("header_fields_per_row", (double)(end.header_fields - start->header_fields) / rows);
+    bench_add_metric("serial_get_per_row", (double)(end.serial_get - start->serial_get) / rows);
+    bench_add_metric("record_unpack_per_row", (double)(end.record_unpack - start->record_unpack) / rows);
+#endif
+}
@@ -0,0 +1,16 @@
+/*
+** test_scan - Read-only scans of the Test table.
+*/
+#ifndef TEST_SCAN_H
+#define TEST_SCAN_H
+
+/*
+** Function prototypes.
+*/
+void scan_table();
+void scan_index();
+void scan_covering();
+void scan_aggregate();
+void scan_decode();
+
+#endif
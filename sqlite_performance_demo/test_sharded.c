@@ -0,0 +1,325 @@
+/*
+** test_sharded - Parallel ingestion hash-partitioned across database files.
+**
+** SQLite has one writer per database, so insert_rows_xact_prepared can only
+** ever use one core. Splitting the rows across N database files, each with
+** its own connection, writer thread and prepared statement, lets N cores
+** insert at once. The test sweeps the shard count from 1 up to --shards to
+** show how the aggregate rows/sec scales, then reads the last set of shards
+** back in key order through an ATTACH based view to show what the merge on
+** the read side costs.
+*/
+#include "test_sharded.h"
+#include "bench.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SHARD_KEY_SIZE 25
+
+
+/*
+** One shard of one step of the sweep. rows holds the row numbers (into the
+** dataset) that hash to this shard.
+*/
+typedef struct shard_t {
+    bench_thread_t thread;
+    char path[1024];
+    int *rows;
+    int num_rows;
+    bench_hist_t latency;
+} shard_t;
+
+
+/*
+** Function prototypes.
+*/
+static double run_step(int num_shards, int keep_files);
+static void shard_main(void *arg);
+static void shard_path(char *buf, size_t size, int shard);
+static uint32_t key_hash(const char *key, int len);
+static void read_back_merged(int num_shards);
+
+
+/*
+** Sweep 1, 2, 4, ... shards up to --shards (default: CPU count), reporting
+** the aggregate rows/sec of each step and its speed up over one shard.
+*/
+void insert_sharded() {
+    const bench_config_t *config = bench_config();
+    int max_shards = config->shards > 0 ? config->shards : bench_cpu_count();
+    double base_rate = 0.0;
+    int64_t total_rows = 0;
+    char name[40];
+
+    for (int shards = 1; ; shards = shards * 2 < max_shards ? shards * 2 : max_shards) {
+        int last = shards == max_shards;
+        double rate = run_step(shards, last);
+
+        if (shards == 1) {
+            base_rate = rate;
+        }
+        total_rows += config->num_rows;
+
+        snprintf(name, sizeof(name), "rows_per_sec_%d_shards", shards);
+        bench_add_metric(name, rate);
+        snprintf(name, sizeof(name), "speedup_%d_shards", shards);
+        bench_add_metric(name, base_rate > 0 ? rate / base_rate : 0.0);
+
+        if (last) {
+            read_back_merged(shards);
+            break;
+        }
+    }
+
+    bench_set_rows(total_rows);
+}
+
+
+/*
+** Load all of the rows into num_shards new database files in parallel.
+** Returns the aggregate rows/sec: all rows over the time until the slowest
+** shard committed. Partitioning the rows is done before the clock starts.
+** The files are deleted afterwards unless keep_files is set.
+*/
+static double run_step(int num_shards, int keep_files) {
+    const bench_config_t *config = bench_config();
+    shard_t *shards;
+    char key[SHARD_KEY_SIZE];
+    int64_t start_ns, elapsed_ns;
+    bench_hist_t *latency = bench_latency();
+
+    shards = calloc(num_shards, sizeof(*shards));
+    if (shards == NULL) {
+        printf("Out of memory creating %d shards.\n", num_shards);
+        exit(-1);
+    }
+
+    /*
+    ** Route each key to a shard by hash, the way an ingest front end would:
+    ** one pass to size each shard, one to fill it.
+    */
+    for (int i = 0; i < config->num_rows; ++i) {
+        int len = sprintf(key, "K-%d", i);
+        shards[key_hash(key, len) % (uint32_t)num_shards].num_rows++;
+    }
+    for (int s = 0; s < num_shards; ++s) {
+        shards[s].rows = malloc(sizeof(int) * (shards[s].num_rows + 1));
+        if (shards[s].rows == NULL) {
+            printf("Out of memory partitioning %d rows.\n", config->num_rows);
+            exit(-1);
+        }
+        shards[s].num_rows = 0;
+        shard_path(shards[s].path, sizeof(shards[s].path), s);
+        bench_hist_init(&shards[s].latency, 0);
+    }
+    for (int i = 0; i < config->num_rows; ++i) {
+        int len = sprintf(key, "K-%d", i);
+        shard_t *shard = &shards[key_hash(key, len) % (uint32_t)num_shards];
+        shard->rows[shard->num_rows++] = i;
+    }
+
+    start_ns = bench_now_ns();
+    for (int s = 0; s < num_shards; ++s) {
+        if (bench_thread_start(&shards[s].thread, shard_main, &shards[s]) != 0) {
+            printf("Unable to start shard thread %d.\n", s);
+            exit(-1);
+        }
+    }
+    for (int s = 0; s < num_shards; ++s) {
+        bench_thread_join(&shards[s].thread);
+    }
+    elapsed_ns = bench_now_ns() - start_ns;
+
+    for (int s = 0; s < num_shards; ++s) {
+        if (latency != NULL) {
+            bench_hist_merge(latency, &shards[s].latency);
+        }
+        bench_hist_free(&shards[s].latency);
+        free(shards[s].rows);
+        if (!keep_files) {
+            remove_database_files(shards[s].path);
+        }
+    }
+    free(shards);
+
+    return elapsed_ns > 0 ? config->num_rows / (elapsed_ns / 1e9) : 0.0;
+}
+
+
+/*
+** Writer thread for one shard: the insert_rows_xact_prepared loop over just
+** this shard's rows, on this shard's own connection.
+*/
+static void shard_main(void *arg) {
+    shard_t *shard = (shard_t *)arg;
+    const bench_dataset_t *data = bench_dataset();
+    const char *sql;
+    char key[SHARD_KEY_SIZE];
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int64_t op_start;
+
+    db = open_fresh_database(shard->path);
+
+    create_test_table(db);
+
+    rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    for (int r = 0; r < shard->num_rows; ++r) {
+        int i = shard->rows[r];
+        int len = sprintf(key, "K-%d", i);
+
+        sqlite3_bind_text(stmt, 1, key, len, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 2, data->num1[i]);
+        sqlite3_bind_double(stmt, 3, data->num2[i]);
+        sqlite3_bind_double(stmt, 4, data->num3[i]);
+        sqlite3_bind_double(stmt, 5, data->num4[i]);
+
+        op_start = bench_now_ns();
+        rc = sqlite3_step(stmt);
+        bench_hist_record(&shard->latency, op_start, bench_now_ns());
+        if (rc != SQLITE_DONE) {
+            die_conn_error(db);
+        }
+        sqlite3_reset(stmt);
+    }
+
+    op_start = bench_now_ns();
+    rc = sqlite3_exec(db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+    bench_hist_record(&shard->latency, op_start, bench_now_ns());
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_close(db) != SQLITE_OK) {
+        die_conn_error(db);
+    }
+}
+
+
+/*
+** Path of a shard's database file: "<--db>.shard<N>".
+*/
+static void shard_path(char *buf, size_t size, int shard) {
+    snprintf(buf, size, "%s.shard%d", bench_config()->db_path, shard);
+}
+
+
+/*
+** FNV-1a. Stable across platforms so the same key always lands in the same
+** shard.
+*/
+static uint32_t key_hash(const char *key, int len) {
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < len; ++i) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+/*
+** Read every shard back in key order through one query. The shards are
+** ATTACHed to the test's connection and combined with a UNION ALL view;
+** "ORDER BY key" over it makes SQLite merge the shards' (already key
+** ordered) primary key indexes. Only SQLITE_LIMIT_ATTACHED shards (10 by
+** default) can be attached, so with more shards only that many are read.
+** The shard files are deleted afterwards.
+*/
+static void read_back_merged(int num_shards) {
+    sqlite3 *db = bench_db();
+    sqlite3_stmt *stmt;
+    char path[1024];
+    char *sql;
+    size_t sql_size;
+    int attached;
+    int rc;
+    int64_t rows = 0, start_ns, elapsed_ns;
+
+    attached = sqlite3_limit(db, SQLITE_LIMIT_ATTACHED, -1);
+    if (attached > num_shards) {
+        attached = num_shards;
+    }
+
+    for (int s = 0; s < attached; ++s) {
+        char *attach;
+
+        shard_path(path, sizeof(path), s);
+        attach = sqlite3_mprintf("ATTACH DATABASE %Q AS shard%d;", path, s);
+        rc = sqlite3_exec(db, attach, NULL, NULL, NULL);
+        sqlite3_free(attach);
+        if (rc != SQLITE_OK) {
+            die_db_error();
+        }
+    }
+
+    sql_size = 64 + (size_t)attached * 80;
+    sql = malloc(sql_size);
+    if (sql == NULL) {
+        printf("Out of memory building the shard view.\n");
+        exit(-1);
+    }
+    strcpy(sql, "CREATE TEMP VIEW AllTest AS ");
+    for (int s = 0; s < attached; ++s) {
+        size_t len = strlen(sql);
+        snprintf(sql + len, sql_size - len, "%sSELECT key, num1, num2, num3, num4 FROM shard%d.Test",
+            s > 0 ? " UNION ALL " : "", s);
+    }
+    strcat(sql, ";");
+    rc = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    free(sql);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    rc = sqlite3_prepare_v2(db, "SELECT key, num1, num2, num3, num4 FROM AllTest ORDER BY key;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    start_ns = bench_now_ns();
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ++rows;
+    }
+    elapsed_ns = bench_now_ns() - start_ns;
+    if (rc != SQLITE_DONE) {
+        die_db_error();
+    }
+    sqlite3_finalize(stmt);
+
+    rc = sqlite3_exec(db, "DROP VIEW AllTest;", NULL, NULL, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+    for (int s = 0; s < attached; ++s) {
+        char *detach = sqlite3_mprintf("DETACH DATABASE shard%d;", s);
+        sqlite3_exec(db, detach, NULL, NULL, NULL);
+        sqlite3_free(detach);
+    }
+    for (int s = 0; s < num_shards; ++s) {
+        shard_path(path, sizeof(path), s);
+        remove_database_files(path);
+    }
+
+    bench_add_metric("merge_shards_read", attached);
+    bench_add_metric("merge_rows", (double)rows);
+    bench_add_metric("merge_read_sec", elapsed_ns / 1e9);
+    bench_add_metric("merge_rows_per_sec", elapsed_ns > 0 ? rows / (elapsed_ns / 1e9) : 0.0);
+}
@@ -0,0 +1,12 @@
+/*
+** test_sharded - Parallel ingestion hash-partitioned across database files.
+*/
+#ifndef TEST_SHARDED_H
+#define TEST_SHARDED_H
+
+/*
+** Function prototypes.
+*/
+void insert_sharded();
+
+#endif
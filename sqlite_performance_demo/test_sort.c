@@ -0,0 +1,196 @@
+/*
+** test_sort - SQLite's external merge sorter under different settings.
+**
+** ORDER BY on a column with no index, and CREATE INDEX, both feed every row
+** through the VdbeSorter: rows are collected in memory up to the cache_size,
+** sorted, written to a temp file as a sorted run (PMA), and the runs are
+** merged at the end. PRAGMA threads lets it sort and write runs, and build
+** the merge tree, on worker threads; temp_store decides whether the runs go
+** to a file or to memory. The test times each workload while stepping
+** through threads, cache_size and temp_store one at a time from a base point
+** of all the threads, the --cache-size (or SQLite's default) and file temp
+** storage. With the benchmark counters built in, the base point is repeated
+** with the sorter's radix sort off to report what it gains over the merge
+** sort for these numeric keys.
+*/
+#include "test_sort.h"
+#include "bench.h"
+#include "bench_thread.h"
+#include "bench_timer.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** cache_size of the base point when --cache-size isn't given, SQLite's own
+** default, in KiB (so "PRAGMA cache_size = -2000").
+*/
+#define SORT_DEFAULT_CACHE "-2000"
+
+
+/*
+** One statement that sorts every row. index workloads are CREATE INDEX
+** statements whose index is dropped again (untimed) after each run.
+*/
+typedef struct sort_workload_t {
+    const char *id;
+    const char *sql;
+    const char *drop_sql;
+} sort_workload_t;
+
+static const sort_workload_t _workloads[] = {
+    { "order_real", "SELECT key FROM Test ORDER BY num1;", NULL },
+    { "order_int", "SELECT key FROM Test ORDER BY CAST(num2 * 1000000 AS INTEGER);", NULL },
+    { "index_real", "CREATE INDEX TestNum3 ON Test(num3);", "DROP INDEX TestNum3;" },
+};
+
+/*
+** Values swept away from the base point. cache_size is in KiB, as a
+** negative PRAGMA cache_size.
+*/
+static const char *_cache_sizes[] = { "-2000", "-65536", "-1048576" };
+static const char *_temp_stores[] = { "file", "memory" };
+
+#define NUM_WORKLOADS (sizeof(_workloads) / sizeof(_workloads[0]))
+#define NUM_CACHE_SIZES (sizeof(_cache_sizes) / sizeof(_cache_sizes[0]))
+#define NUM_TEMP_STORES (sizeof(_temp_stores) / sizeof(_temp_stores[0]))
+
+
+/*
+** Function prototypes.
+*/
+static double run_point(const sort_workload_t *workload, int threads, const char *cache_size,
+    const char *temp_store);
+static int max_sorter_threads();
+
+
+/*
+** For each workload, sweep threads (0, 1, 2, 4, ... up to what SQLite
+** allows, or just --sorter-threads), then cache_size, then temp_store.
+** Reported as "<workload>_threads_<n>_sec", "..._cache_<kib>_sec" and
+** "..._temp_<mode>_sec", plus "..._mergesort_sec" and "..._radix_speedup".
+*/
+void sort_sweep() {
+    const bench_config_t *config = bench_config();
+    const char *base_cache = config->cache_size != NULL ? config->cache_size : SORT_DEFAULT_CACHE;
+    int max_threads = max_sorter_threads();
+    int base_threads = config->sorter_threads >= 0 ? config->sorter_threads : max_threads;
+    int64_t points = 0;
+    char name[40];
+
+    for (size_t w = 0; w < NUM_WORKLOADS; ++w) {
+        const sort_workload_t *workload = &_workloads[w];
+        double sec;
+
+        for (int threads = config->sorter_threads >= 0 ? base_threads : 0; ;
+            threads = threads == 0 ? 1 : threads * 2 < max_threads ? threads * 2 : max_threads) {
+            sec = run_point(workload, threads, base_cache, "file");
+            snprintf(name, sizeof(name), "%s_threads_%d_sec", workload->id, threads);
+            bench_add_metric(name, sec);
+            ++points;
+
+            if (threads >= max_threads || config->sorter_threads >= 0) {
+                break;
+            }
+        }
+
+        for (size_t c = 0; c < NUM_CACHE_SIZES; ++c) {
+            sec = run_point(workload, base_threads, _cache_sizes[c], "file");
+            snprintf(name, sizeof(name), "%s_cache_%s_sec", workload->id, _cache_sizes[c] + 1);
+            bench_add_metric(name, sec);
+            ++points;
+        }
+
+        for (size_t t = 0; t < NUM_TEMP_STORES; ++t) {
+            sec = run_point(workload, base_threads, base_cache, _temp_stores[t]);
+            snprintf(name, sizeof(name), "%s_temp_%s_sec", workload->id, _temp_stores[t]);
+            bench_add_metric(name, sec);
+            ++points;
+        }
+
+#if defined SQLITE_BENCH_COUNTERS
+        {
+            double radix_sec, merge_sec;
+            int lists = sqlite3_bench_sorter_radix_lists;
+
+            radix_sec = run_point(workload, base_threads, base_cache, "file");
+            snprintf(name, sizeof(name), "%s_radix_lists", workload->id);
+            bench_add_metric(name, sqlite3_bench_sorter_radix_lists - lists);
+
+            sqlite3_bench_sorter_radix = 0;
+            merge_sec = run_point(workload, base_threads, base_cache, "file");
+            sqlite3_bench_sorter_radix = 1;
+            points += 2;
+
+            snprintf(name, sizeof(name), "%s_mergesort_sec", workload->id);
+            bench_add_metric(name, merge_sec);
+            snprintf(name, sizeof(name), "%s_radix_speedup", workload->id);
+            bench_add_metric(name, radix_sec > 0 ? merge_sec / radix_sec : 0.0);
+        }
+#endif
+    }
+
+    bench_set_rows(points * config->num_rows);
+}
+
+
+/*
+** Run one workload with the given sorter settings. Returns the time the
+** statement took in seconds, which also goes into the test's latency
+** histogram as one operation.
+*/
+static double run_point(const sort_workload_t *workload, int threads, const char *cache_size,
+    const char *temp_store) {
+    sqlite3 *db = bench_db();
+    sqlite3_stmt *stmt;
+    char value[16];
+    int rc;
+    int64_t start_ns, op_start;
+    double sec;
+
+    snprintf(value, sizeof(value), "%d", threads);
+    apply_pragma(db, "threads", value);
+    apply_pragma(db, "cache_size", cache_size);
+    apply_pragma(db, "temp_store", temp_store);
+
+    rc = sqlite3_prepare_v2(db, workload->sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_db_error();
+    }
+
+    start_ns = bench_now_ns();
+    op_start = latency_begin();
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+    }
+    latency_end(op_start);
+    sec = (bench_now_ns() - start_ns) / 1e9;
+
+    if (rc != SQLITE_DONE) {
+        die_db_error();
+    }
+    sqlite3_finalize(stmt);
+
+    if (workload->drop_sql != NULL) {
+        rc = sqlite3_exec(db, workload->drop_sql, NULL, NULL, NULL);
+        if (rc != SQLITE_OK) {
+            die_db_error();
+        }
+    }
+
+    return sec;
+}
+
+
+/*
+** The most worker threads SQLite will give the sorter: the CPU count,
+** clamped to the build's SQLITE_MAX_WORKER_THREADS.
+*/
+static int max_sorter_threads() {
+    sqlite3 *db = bench_db();
+    int limit = sqlite3_limit(db, SQLITE_LIMIT_WORKER_THREADS, -1);
+    int threads;
+
+    sqlite3_limit(db, SQLITE_LIMIT_WORKER_THREADS, bench_cpu_count());
+    threads = sqlite3_limit(db, SQLITE_LIMIT_WORKER_THREADS, limit);
+    return threads;
+}
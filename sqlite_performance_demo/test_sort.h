@@ -0,0 +1,12 @@
+/*
+** test_sort - SQLite's external merge sorter under different settings.
+*/
+#ifndef TEST_SORT_H
+#define TEST_SORT_H
+
+/*
+** Function prototypes.
+*/
+void sort_sweep();
+
+#endif
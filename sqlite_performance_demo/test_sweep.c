@@ -0,0 +1,192 @@
+/*
+** test_sweep - Commit interval sweep of the prepared insert.
+**
+** insert_rows_xact_prepared puts every row in one transaction, which no
+** production writer can do. This test commits every 1, 10, 100, ... rows (up
+** to all of them) under each journal_mode / synchronous combination, so the
+** commit interval can be picked from the throughput and commit latency
+** curves rather than guessed. Each point loads a new database file so every
+** point starts from the same empty table.
+*/
+#include "test_sweep.h"
+#include "bench.h"
+#include "bench_timer.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+** Each point stops after this many commits, so the small batch sizes (one
+** fsync per row at synchronous=FULL) finish in seconds rather than hours.
+*/
+#define SWEEP_MAX_COMMITS 1000
+#define SWEEP_KEY_SIZE 25
+
+
+/*
+** Modes swept when --journal-mode / --synchronous aren't given. Given ones
+** are swept alone.
+*/
+static const char *_journal_modes[] = { "DELETE", "TRUNCATE", "WAL" };
+static const char *_sync_modes[] = { "OFF", "NORMAL", "FULL" };
+
+#define NUM_JOURNAL_MODES (sizeof(_journal_modes) / sizeof(_journal_modes[0]))
+#define NUM_SYNC_MODES (sizeof(_sync_modes) / sizeof(_sync_modes[0]))
+
+
+/*
+** Function prototypes.
+*/
+static int64_t run_point(const char *journal_mode, const char *synchronous, int batch_rows, int num_rows,
+    bench_hist_t *commit_latency);
+static void add_point_metric(const char *journal_mode, const char *synchronous, int batch_rows, const char *what,
+    double value);
+
+
+/*
+** For every mode combination, insert with a commit every 1, 10, 100, ...
+** rows and finally with a single commit. Reported per point as
+** "<journal>_<sync>_<batch>_rows_per_sec" and "..._p99_usec" (of COMMIT).
+** The test's latency histogram holds every COMMIT of the whole sweep.
+*/
+void insert_xact_sweep() {
+    const bench_config_t *config = bench_config();
+    const char *const *journal_modes = _journal_modes;
+    const char *const *sync_modes = _sync_modes;
+    size_t num_journal_modes = NUM_JOURNAL_MODES;
+    size_t num_sync_modes = NUM_SYNC_MODES;
+    bench_hist_t commit_latency;
+    bench_hist_t *latency = bench_latency();
+    int64_t total_rows = 0;
+
+    if (config->journal_mode != NULL) {
+        journal_modes = &config->journal_mode;
+        num_journal_modes = 1;
+    }
+    if (config->synchronous != NULL) {
+        sync_modes = &config->synchronous;
+        num_sync_modes = 1;
+    }
+
+    bench_hist_init(&commit_latency, 0);
+
+    for (size_t j = 0; j < num_journal_modes; ++j) {
+        for (size_t s = 0; s < num_sync_modes; ++s) {
+            for (int batch = 1; ; batch = batch <= config->num_rows / 10 ? batch * 10 : config->num_rows) {
+                int rows = (int64_t)batch * SWEEP_MAX_COMMITS < config->num_rows ? batch * SWEEP_MAX_COMMITS : config->num_rows;
+                int64_t elapsed_ns;
+
+                bench_hist_reset(&commit_latency);
+                elapsed_ns = run_point(journal_modes[j], sync_modes[s], batch, rows, &commit_latency);
+                total_rows += rows;
+
+                add_point_metric(journal_modes[j], sync_modes[s], batch, "rows_per_sec",
+                    elapsed_ns > 0 ? rows / (elapsed_ns / 1e9) : 0.0);
+                add_point_metric(journal_modes[j], sync_modes[s], batch, "p99_usec",
+                    bench_hist_percentile(&commit_latency, 99.0) / 1e3);
+                if (latency != NULL) {
+                    bench_hist_merge(latency, &commit_latency);
+                }
+
+                if (batch == config->num_rows) {
+                    break;
+                }
+            }
+        }
+    }
+
+    bench_hist_free(&commit_latency);
+    bench_set_rows(total_rows);
+}
+
+
+/*
+** Load num_rows rows into a new "<--db>.sweep" database, committing every
+** batch_rows rows. Returns the time from the first BEGIN to the last COMMIT;
+** each COMMIT's own time goes into commit_latency.
+*/
+static int64_t run_point(const char *journal_mode, const char *synchronous, int batch_rows, int num_rows,
+    bench_hist_t *commit_latency) {
+    const bench_dataset_t *data = bench_dataset();
+    const char *sql;
+    char path[1024];
+    char key[SWEEP_KEY_SIZE];
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    int rc;
+    int key_len;
+    int64_t start_ns, commit_start, elapsed_ns;
+
+    snprintf(path, sizeof(path), "%s.sweep", bench_config()->db_path);
+    db = open_fresh_database(path);
+    apply_pragma(db, "journal_mode", journal_mode);
+    apply_pragma(db, "synchronous", synchronous);
+
+    create_test_table(db);
+
+    sql = "INSERT INTO Test(key, num1, num2, num3, num4) VALUES(?, ?, ?, ?, ?);";
+    rc = sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        die_conn_error(db);
+    }
+
+    start_ns = bench_now_ns();
+
+    for (int i = 0; i < num_rows; ++i) {
+        if (i % batch_rows == 0) {
+            rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+            if (rc != SQLITE_OK) {
+                die_conn_error(db);
+            }
+        }
+
+        key_len = sprintf(key, "K-%d", i);
+        sqlite3_bind_text(stmt, 1, key, key_len, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 2, data->num1[i]);
+        sqlite3_bind_double(stmt, 3, data->num2[i]);
+        sqlite3_bind_double(stmt, 4, data->num3[i]);
+        sqlite3_bind_double(stmt, 5, data->num4[i]);
+
+        rc = sqlite3_step(stmt);
+        if (rc != SQLITE_DONE) {
+            die_conn_error(db);
+        }
+        sqlite3_reset(stmt);
+
+        if ((i + 1) % batch_rows == 0 || i + 1 == num_rows) {
+            commit_start = bench_now_ns();
+            rc = sqlite3_exec(db, "COMMIT TRANSACTION;", NULL, NULL, NULL);
+            bench_hist_record(commit_latency, commit_start, bench_now_ns());
+            if (rc != SQLITE_OK) {
+                die_conn_error(db);
+            }
+        }
+    }
+
+    elapsed_ns = bench_now_ns() - start_ns;
+
+    sqlite3_finalize(stmt);
+    if (sqlite3_close(db) != SQLITE_OK) {
+        die_conn_error(db);
+    }
+    remove_database_files(path);
+
+    return elapsed_ns;
+}
+
+
+/*
+** Add one metric of a sweep point, named "<journal>_<sync>_<batch>_<what>"
+** in lower case.
+*/
+static void add_point_metric(const char *journal_mode, const char *synchronous, int batch_rows, const char *what,
+    double value) {
+    char name[40];
+
+    snprintf(name, sizeof(name), "%s_%s_%d_%s", journal_mode, synchronous, batch_rows, what);
+    for (char *p = name; *p != '\0'; ++p) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    bench_add_metric(name, value);
+}
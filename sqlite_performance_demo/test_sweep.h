@@ -0,0 +1,12 @@
+/*
+** test_sweep - Commit interval sweep of the prepared insert.
+*/
+#ifndef TEST_SWEEP_H
+#define TEST_SWEEP_H
+
+/*
+** Function prototypes.
+*/
+void insert_xact_sweep();
+
+#endif